@@ -2,10 +2,17 @@
 #include <SPI.h>
 #include <MFRC522.h>
 #include <SoftwareSerial.h>
+#include <Wire.h>
+#include <EEPROM.h>
+#include <util/atomic.h>
 
 // Debug configuration - set to 1 to enable debug output, 0 to disable
 #define DEBUG_ENABLED 1
 
+// Node transport - set to 1 to expose the node as an I2C slave register map instead of the UART byte-code stream
+#define NODE_TRANSPORT_I2C 0
+#define I2C_SLAVE_ADDRESS 0x42
+
 // Debug macro 
 #if DEBUG_ENABLED
   #define DEBUG_PRINT(x) Serial.print(x)
@@ -32,6 +39,12 @@ enum MessageCode : uint8_t {
   MSG_RFID_WRITE_COMPLETED = 10,
   MSG_STATUS_UPDATE = 11,      // General status update
   MSG_HEARTBEAT = 12,          // Periodic heartbeat to indicate Arduino is alive
+  MSG_POWER_FAIL = 13,         // Supply dropped below the warning threshold, sent on recovery
+  MSG_BULK_ACK = 14,           // Bulk transfer reply: "ACK:offset", "DONE:target" or "ERR_<reason>:value"
+  MSG_RFID_RATE_LIMITED = 15,  // Card locked out by the tap rate limiter: "seconds,uid"
+  MSG_INTRUSION_CONFIRMED = 16, // A correlation rule matched: "rule,deltaMs"
+  MSG_EVENT_AGGREGATE = 17,    // Events counted by an aggregating filter slot: "slot,count"
+  MSG_ANOMALY_ALERT = 18,      // A counter rate reached its threshold: "tracker,rate,threshold"
   
   // Pico -> Arduino commands
   CMD_SET_LED_RGB = 20,        // Takes RGB data: "r,g,b" (0-255 each)
@@ -41,7 +54,19 @@ enum MessageCode : uint8_t {
   CMD_RFID_WRITE_CONFIRM = 24, // Confirm and activate RFID write mode
   CMD_RFID_NORMAL_MODE = 25,
   CMD_ACK = 26,
-  CMD_REQUEST_STATUS = 27     // Request status update
+  CMD_REQUEST_STATUS = 27,    // Request status update
+  CMD_SET_RFID_DUTY = 28,     // Takes reader duty data: "window,period,mode" (ms, ms, RfidPowerMode)
+  CMD_BULK_BEGIN = 29,        // Takes "target,length,crc" - starts a bulk transfer into a BulkTarget region
+  CMD_BULK_DATA = 30,         // Binary chunk frame, see receiveBulkChunk()
+  CMD_SET_FILTER = 31,        // Takes "slot,code,zone,reader,action" - see EventFilter
+  CMD_SET_ANOMALY = 32        // Takes "tracker,threshold" - see AnomalyTracker
+};
+
+// RFID reader power state between scheduled polls
+enum RfidPowerMode : uint8_t {
+  RFID_POWER_ACTIVE = 0,      // Field always up (no duty cycling)
+  RFID_POWER_ANTENNA_OFF = 1, // Only the antenna driver is switched off
+  RFID_POWER_SOFT_DOWN = 2    // Soft power-down of the whole reader (registers retained)
 };
 
 // Hardware pins
@@ -51,9 +76,244 @@ enum MessageCode : uint8_t {
 #define MOTION_SENSOR_PIN 7
 #define BUZZER_PIN 8
 #define REARM_BUTTON_PIN 2
+#define AUX_SENSOR_PIN 4     // Optional vibration sensor or second zone, active LOW
 #define SS_PIN 10
 #define RST_PIN 9
 
+// I2C register map (NODE_TRANSPORT_I2C). The master sets the register pointer with the
+// first written byte, then either keeps writing (actuators, ack, command) or reads a burst.
+// REG_ID..REG_EVENTS fit in one 32 byte Wire transfer so a single read returns the whole snapshot.
+#define I2C_MAP_VERSION 1
+#define I2C_EVENT_FIFO_SIZE 8
+#define I2C_PAYLOAD_SIZE 16
+#define I2C_EVENT_HAS_PAYLOAD 0x80 // Set on the FIFO entry whose data sits in the payload mailbox (at most one)
+
+enum RegisterAddress : uint8_t {
+  REG_ID = 0x00,              // Map version (read only)
+  REG_FLAGS = 0x01,           // Sensor/mode flags, see FLAG_* (read only)
+  REG_MOTION_AGE = 0x02,      // uint32 ms since last motion change (read only)
+  REG_LED_RED = 0x06,         // Actuators (read/write)
+  REG_LED_GREEN = 0x07,
+  REG_LED_BLUE = 0x08,
+  REG_BUZZER = 0x09,
+  REG_COUNTERS = 0x0A,        // uint16 counters, see NodeCounters (read only)
+  REG_EVENT_COUNT = 0x14,     // Number of valid entries in REG_EVENTS (read only)
+  REG_EVENTS = 0x15,          // Event FIFO, oldest first (read only)
+  REG_PAYLOAD_LENGTH = 0x1D,  // Length of the payload mailbox (read only)
+  REG_PAYLOAD = 0x1E,         // Data of the one payload-carrying event in the FIFO (read only)
+  REG_EVENT_ACK = 0x2E,       // Write n to drop the n oldest events from the FIFO
+  REG_COMMAND = 0x2F          // Write a command code followed by its text payload, once FLAG_COMMAND_BUSY is clear
+};
+
+enum RegisterFlag : uint8_t {
+  FLAG_MOTION = 0x01,
+  FLAG_BUTTON = 0x02,
+  FLAG_RFID_WRITE_MODE = 0x04,
+  FLAG_RFID_WRITE_PREPARED = 0x08,
+  FLAG_BUZZER = 0x10,
+  FLAG_COMMAND_BUSY = 0x20,   // A REG_COMMAND write is not handled yet - further writes are dropped
+  FLAG_EVENT_OVERFLOW = 0x80  // Events were dropped (FIFO and held events full), cleared on ack
+};
+
+// Firmware counters, reported over I2C and kept regardless of transport
+struct NodeCounters {
+  uint16_t motionEvents;
+  uint16_t rfidReads;
+  uint16_t rfidFailures;
+  uint16_t heartbeats;
+  uint16_t linkErrors;        // Unknown command codes, stray or short bulk frames and bulk CRC failures
+};
+
+struct __attribute__((packed)) NodeRegisterMap {
+  uint8_t id;
+  uint8_t flags;
+  uint32_t motionAge;
+  uint8_t ledRed;
+  uint8_t ledGreen;
+  uint8_t ledBlue;
+  uint8_t buzzer;
+  NodeCounters counters;
+  uint8_t eventCount;
+  uint8_t events[I2C_EVENT_FIFO_SIZE];
+  uint8_t payloadLength;
+  char payload[I2C_PAYLOAD_SIZE];
+};
+static_assert(sizeof(NodeRegisterMap) == REG_EVENT_ACK, "Register map layout does not match RegisterAddress");
+
+// Power-fail early warning. The 1.1V bandgap is sampled against AVcc every Timer0 overflow (~1ms);
+// when the supply falls below the threshold the journal is flushed to EEPROM from the ADC interrupt
+// while the bulk capacitors still hold the board up. Nothing else may use the ADC (no analogRead).
+// Thresholds are a drop relative to the supply measured at boot, so the +-10% bandgap tolerance
+// and USB vs. barrel jack supplies do not move the trip point.
+#define BANDGAP_MV 1100UL              // Only used to report millivolts
+#define POWER_FAIL_DROP_PERCENT 12     // Trip 12% below the boot supply (4.4V on a 5V board)
+#define POWER_RECOVER_DROP_PERCENT 6   // Recovered once back within 6% of it
+#define POWER_MONITOR_WARMUP_SAMPLES 16 // Bandgap settling after the mux switch
+#define POWER_CALIBRATION_SAMPLES 16   // Readings averaged into the boot baseline
+#define POWER_FAIL_REFLUSH_MS 60000UL  // Journal stays valid this long after a recovered dip, later dips reuse it
+#define POWER_FAIL_REPORT_MS 60000UL   // Minimum time between MSG_POWER_FAIL reports, later dips are counted
+
+// EEPROM layout
+#define EEPROM_JOURNAL_ADDR 0          // PowerJournal, written on power fail (28 bytes reserved)
+#define EEPROM_FILTER_HEADER_ADDR 28   // FilterTableHeader (4 bytes reserved)
+#define EEPROM_FILTER_ADDR 32          // EventFilter table (32 bytes)
+#define EEPROM_CONFIG_ADDR 64          // BULK_TARGET_CONFIG blob
+#define EEPROM_CONFIG_SIZE 128
+#define EEPROM_RULES_ADDR 192          // BULK_TARGET_RULES blob
+#define EEPROM_RULES_SIZE 64
+#define EEPROM_ALLOWLIST_ADDR 256      // BULK_TARGET_ALLOWLIST blob
+#define EEPROM_ALLOWLIST_SIZE 768
+#define JOURNAL_VALID 0xA5
+
+// Last-gasp journal - kept small since every changed byte costs ~3.4ms of hold-up time
+struct PowerJournal {
+  uint8_t pendingCount;
+  uint8_t pendingEvents[I2C_EVENT_FIFO_SIZE];
+  NodeCounters counters;
+  uint16_t powerFailures;
+  uint16_t vccMillivolts;
+  uint8_t valid;                       // Written last, JOURNAL_VALID marks a completed flush
+};
+static_assert(sizeof(PowerJournal) <= EEPROM_FILTER_HEADER_ADDR - EEPROM_JOURNAL_ADDR, "Power journal exceeds its EEPROM slot");
+
+// Bulk transfer sub-protocol (UART transport). A blob is streamed straight into an EEPROM region as
+// CRC-checked chunks; the node acknowledges cumulatively once per window, so the sender never has more
+// than one window in flight and the window (BULK_WINDOW_CHUNKS frames) fits the 64 byte SoftwareSerial
+// RX buffer while the node is busy writing EEPROM.
+#define BULK_CHUNK_SIZE 24
+#define BULK_WINDOW_CHUNKS 2
+#define BULK_FRAME_TIMEOUT 100      // ms to receive the rest of a frame after its command byte
+#define BULK_IDLE_ACK_MS 150        // Acknowledge a partial window once the line has been idle this long
+#define BULK_RESYNC_IDLE_MS 20      // Line idle time that marks the end of a corrupted window
+#define BULK_SESSION_TIMEOUT 5000
+#define BULK_HEADER_SIZE 4          // uint16 length + uint16 CRC in front of every committed blob
+
+// Events raised while they cannot be sent are held and sent in order once the line is free: during a
+// bulk transfer, whose frames would be broken up by our transmissions, and on I2C while the event FIFO
+// is full or the payload mailbox still holds an event the master has not acked
+#define HELD_EVENT_COUNT 6
+#define HELD_EVENT_DATA_SIZE 28
+
+enum BulkTarget : uint8_t {
+  BULK_TARGET_CONFIG = 1,
+  BULK_TARGET_ALLOWLIST = 2,
+  BULK_TARGET_RULES = 3       // Correlation rules, see CorrelationRule
+};
+
+struct HeldEvent {
+  uint8_t code;
+  bool hasData;
+  char data[HELD_EVENT_DATA_SIZE];
+};
+
+struct BulkSession {
+  bool active;
+  uint8_t target;
+  uint16_t regionAddress;
+  uint16_t length;
+  uint16_t expectedCrc;
+  uint16_t nextOffset;
+  uint16_t runningCrc;
+  uint8_t framesSinceAck;
+  unsigned long lastActivity;
+};
+
+// Per-UID tap rate limiting. Every recently seen card has a token bucket; a tap on an empty bucket
+// locks the card out for a period that doubles with each further violation. Locked out taps never
+// reach the auth backend and are reported once per lockout. A reader-wide bucket sits behind the
+// table so rotating UIDs or a fifth card cannot get a fresh burst every time.
+#define RATE_LIMIT_TABLE_SIZE 4
+#define RATE_LIMIT_BURST 3                 // Taps a card may make back to back
+#define RATE_LIMIT_REFILL_MS 5000UL        // One tap regained every 5 seconds
+#define RATE_LIMIT_LOCKOUT_MS 10000UL      // First lockout, doubled per level
+#define RATE_LIMIT_MAX_LEVEL 5             // Lockout caps at 10s << 5 = 320 seconds
+#define RATE_LIMIT_FORGIVE_MS 600000UL     // Lockout level resets after 10 minutes without violation
+#define RATE_LIMIT_READER_BURST 6          // Reader-wide backstop for rotating UIDs and more cards than the table holds
+#define RATE_LIMIT_READER_REFILL_MS 2000UL // At most 30 taps a minute reach the backend once the burst is spent
+
+struct UidRateEntry {
+  uint32_t uidHash;                  // 0 marks a free slot
+  uint8_t tokens;
+  uint8_t lockoutLevel;
+  unsigned long lastRefill;
+  unsigned long lastSeen;
+  unsigned long lockoutStart;
+  unsigned long lockoutDuration;     // 0 when not locked out
+};
+
+// On-node correlation rules. Inputs record the time of their last edge; every loop pass checks each
+// rule once (fixed time, no event history) and confirms an intrusion when both of its inputs fired
+// within the rule window. Rules are uploaded as a BULK_TARGET_RULES blob of packed CorrelationRule.
+#define CORRELATION_MAX_RULES 8
+#define RULE_ORDERED 0x01            // The first input has to fire before the second
+
+enum CorrelationInput : uint8_t {
+  INPUT_PIR = 0,                     // Motion sensor rising edge
+  INPUT_AUX = 1,                     // Aux sensor becoming active
+  INPUT_RFID_FAIL = 2,               // Failed card read
+  INPUT_RATE_LIMIT = 3,              // Card locked out by the tap rate limiter
+  CORRELATION_INPUT_COUNT
+};
+
+struct __attribute__((packed)) CorrelationRule {
+  uint8_t first;
+  uint8_t second;
+  uint16_t windowMs;
+  uint8_t flags;
+};
+
+// Event filter and routing table, set by the gateway with CMD_SET_FILTER and kept in EEPROM.
+// Every outgoing event is matched against the slots in order (0 is a wildcard for code, zone
+// and reader); the first match decides, unmatched events are forwarded. Aggregating slots count
+// their events and report the count every FILTER_AGGREGATE_INTERVAL instead.
+#define FILTER_TABLE_SIZE 8
+#define FILTER_AGGREGATE_INTERVAL 10000UL
+#define ZONE_PIR 1
+#define READER_MAIN 1
+
+enum FilterAction : uint8_t {
+  FILTER_FORWARD = 0,
+  FILTER_SUPPRESS = 1,
+  FILTER_AGGREGATE = 2,
+  FILTER_EMPTY = 0xFF               // Erased EEPROM reads as an empty slot
+};
+
+struct EventFilter {
+  uint8_t code;
+  uint8_t zone;
+  uint8_t reader;
+  uint8_t action;
+};
+
+// Guards the table against whatever an earlier sketch left in EEPROM - an invalid table loads as empty
+#define FILTER_TABLE_VALID 0x5A
+
+struct __attribute__((packed)) FilterTableHeader {
+  uint16_t crc;                     // CRC-16/CCITT-FALSE over the whole EventFilter table
+  uint8_t valid;                    // Written last, FILTER_TABLE_VALID marks a committed table
+};
+
+// Counter anomaly detection. Every ANOMALY_SAMPLE_MS the growth of the watched NodeCounters goes into
+// a ring of buckets, so each rate covers the last minute without keeping any event history. A tracker
+// alerts once when its rate reaches the threshold and re-arms when the rate drops below it again.
+#define ANOMALY_SAMPLE_MS 10000UL
+#define ANOMALY_BUCKETS 6                  // Rolling window of 6 x 10 s
+#define ANOMALY_MIN_READS 4                // Card reads in the window before the failure ratio counts
+
+enum AnomalyTracker : uint8_t {
+  ANOMALY_RFID_FAILURES = 0,         // Failed card reads in % of all reads
+  ANOMALY_PIR_CHATTER = 1,           // Motion sensor edges per window
+  ANOMALY_LINK_ERRORS = 2,           // Link errors per window, see NodeCounters::linkErrors
+  ANOMALY_TRACKER_COUNT
+};
+
+struct AnomalyBucket {
+  uint8_t rfidReads;
+  uint8_t rfidFailures;
+  uint8_t motionEvents;
+  uint8_t linkErrors;
+};
+
 // Hardware objects
 SoftwareSerial picoSerial(A0, A1); // RX=A0, TX=A1
 MFRC522 rfidReader(SS_PIN, RST_PIN);
@@ -64,6 +324,18 @@ bool lastButtonState = HIGH;
 bool rfidWriteMode = false;
 bool rfidWritePrepared = false;
 char rfidWriteKey[17] = ""; // For storing key to write
+NodeCounters nodeCounters = {0, 0, 0, 0, 0};
+uint8_t ledState[3] = {0, 0, 0}; // Last applied RGB value
+
+#if NODE_TRANSPORT_I2C
+// Register map shared with the Wire ISR - main loop updates it inside ATOMIC_BLOCK
+volatile NodeRegisterMap registerMap;
+volatile uint8_t registerPointer = 0;
+volatile bool actuatorsDirty = false;
+volatile bool pendingCommandReady = false;
+volatile uint8_t pendingCommand = 0;
+volatile char pendingCommandPayload[I2C_PAYLOAD_SIZE + 1];
+#endif
 
 // Heartbeat and status variables
 unsigned long lastHeartbeat = 0;
@@ -72,16 +344,127 @@ unsigned long lastMotionChange = 0;
 unsigned long lastMotionStatusReport = 0;
 const unsigned long motionStatusInterval = 5000;
 
+// RFID reader duty cycle - the field is up for rfidPollWindow ms out of every rfidPollPeriod ms
+RfidPowerMode rfidIdlePowerMode = RFID_POWER_SOFT_DOWN;
+unsigned long rfidPollWindow = 100;
+unsigned long rfidPollPeriod = 300;
+bool rfidFieldOn = true;
+unsigned long rfidWakeTime = 0;          // Start of the current poll window
+unsigned long rfidFieldOnTotal = 0;      // ms the field was up since boot (closed windows only)
+unsigned long rfidLastWakeMicros = 0;    // Time the last wake-up took
+unsigned long rfidLastTapLatency = 0;    // ms from field up to card detection for the last duty-cycled tap
+uint32_t rfidPresentUid = 0;             // UID hash of the card seen in the last poll windows
+unsigned long rfidPresentLastSeen = 0;
+
+// Power-fail state shared with the ADC interrupt
+volatile bool powerFailActive = false;
+volatile uint16_t vccReading = 0;
+volatile uint8_t powerMonitorWarmup = POWER_MONITOR_WARMUP_SAMPLES;
+volatile uint16_t powerFailTripReading = 0;    // 0 until the boot baseline is calibrated
+volatile uint16_t powerRecoverReading = 0;
+uint32_t powerCalibrationSum = 0;              // ADC interrupt only
+uint8_t powerCalibrationCount = 0;
+volatile bool journalFlushed = false;         // Journal marker on disk is valid
+volatile unsigned long lastJournalFlush = 0;
+uint16_t powerFailures = 0;
+bool powerFailReportPending = false;
+bool powerFailReported = false;
+unsigned long lastPowerFailReport = 0;
+uint16_t pendingPowerFailMv = 0;
+
+// Bulk transfer state
+BulkSession bulkSession = {false, 0, 0, 0, 0, 0, 0, 0, 0};
+HeldEvent heldEvents[HELD_EVENT_COUNT];
+uint8_t heldEventCount = 0;
+
+// Tap rate limiter state
+UidRateEntry uidRateTable[RATE_LIMIT_TABLE_SIZE];
+uint8_t readerTokens = RATE_LIMIT_READER_BURST;
+unsigned long readerLastRefill = 0;
+bool readerLimitReported = false;
+
+// Correlation state - used until a rules blob has been uploaded: PIR plus aux within 10 s.
+// Card-failure rules are left to the upload, a single misread by a resident must not confirm an intrusion.
+const CorrelationRule defaultCorrelationRules[] = {
+  {INPUT_PIR, INPUT_AUX, 10000, 0}
+};
+CorrelationRule correlationRules[CORRELATION_MAX_RULES];
+uint8_t correlationRuleCount = 0;
+unsigned long ruleLastFired[CORRELATION_MAX_RULES];
+unsigned long inputLastEdge[CORRELATION_INPUT_COUNT];
+uint8_t inputSeen = 0;               // Bit per CorrelationInput that has fired since boot
+bool lastAuxActive = false;
+
+// Event filter state
+EventFilter eventFilters[FILTER_TABLE_SIZE];
+uint16_t filterAggregateCounts[FILTER_TABLE_SIZE];
+unsigned long lastAggregateReport = 0;
+
+// Anomaly detection state - thresholds are set with CMD_SET_ANOMALY, 0 disables a tracker
+uint16_t anomalyThresholds[ANOMALY_TRACKER_COUNT] = {50, 60, 5};
+AnomalyBucket anomalyBuckets[ANOMALY_BUCKETS];
+uint8_t anomalyBucketIndex = 0;
+NodeCounters anomalyBaseline = {0, 0, 0, 0, 0}; // Counters at the last sample
+uint8_t anomalyActive = 0;           // Bit per AnomalyTracker that is above its threshold
+unsigned long lastAnomalySample = 0;
+
 // Function declarations
 void sendMessage(MessageCode code);
 void sendMessageWithData(MessageCode code, const char* data);
-void processCommand(uint8_t cmd);
+bool sendMessageIfFree(MessageCode code, const char* data);
+bool transmitEvent(uint8_t code, const char* data);
+void holdEvent(uint8_t code, const char* data);
+void releaseHeldEvents();
+bool commandHasPayload(uint8_t cmd);
+void readCommandPayload(char* payload, size_t size);
+void processCommand(uint8_t cmd, const char* payload);
 void setLEDColor(int red, int green, int blue);
 void parseAndSetRGB(const char* rgbData);
 void handleRFIDCard();
 bool writeSecretKeyToRFID(const char* secretKey);
 bool readSecretKeyFromRFID(char* secretKey);
 void sendStatusUpdate();
+bool rfidDutyCycling();
+void setRfidField(bool on);
+void updateRfidPower(unsigned long currentTime);
+void parseAndSetRfidDuty(const char* dutyData);
+void startPowerMonitor();
+void flushPowerJournal(uint16_t reading);
+bool restorePowerJournal(PowerJournal& journal);
+void checkPowerRecovery();
+void sendPowerFailReport(uint16_t vccMillivolts);
+bool eepromUpdate(int address, uint8_t value);
+uint16_t crc16Update(uint16_t crc, uint8_t data);
+bool bulkRegionFor(uint8_t target, uint16_t& address, uint16_t& size);
+void beginBulkTransfer(const char* bulkData);
+void receiveBulkChunk();
+void resyncBulkTransfer();
+void sendBulkReply(const char* status, unsigned int value);
+void finishBulkTransfer();
+void serviceBulkTransfer(unsigned long currentTime);
+uint32_t hashCardUid();
+bool allowCardTap(unsigned long currentTime);
+bool takeReaderToken(unsigned long currentTime);
+void sendRateLimitedEvent(unsigned long lockoutDuration);
+uint16_t readBulkBlob(uint8_t target, uint8_t* buffer, uint16_t maxLength);
+void loadCorrelationRules();
+void noteCorrelationInput(uint8_t input, unsigned long currentTime);
+void evaluateCorrelationRules(unsigned long currentTime);
+void loadEventFilters();
+uint16_t eventFilterCrc();
+void parseAndSetFilter(const char* filterData);
+bool routeEvent(uint8_t code);
+void reportAggregatedEvents(unsigned long currentTime);
+void parseAndSetAnomaly(const char* anomalyData);
+uint8_t counterGrowth(uint16_t current, uint16_t baseline);
+void sampleAnomalyTrackers(unsigned long currentTime);
+#if NODE_TRANSPORT_I2C
+void onI2CReceive(int byteCount);
+void onI2CRequest();
+bool queueRegisterEvent(uint8_t code, const char* data);
+void refreshRegisterSnapshot();
+void serviceRegisterMap();
+#endif
 
 void setup() {
   Serial.begin(9600);
@@ -94,9 +477,28 @@ void setup() {
   pinMode(MOTION_SENSOR_PIN, INPUT_PULLUP);
   pinMode(BUZZER_PIN, OUTPUT);
   pinMode(REARM_BUTTON_PIN, INPUT_PULLUP);
+  pinMode(AUX_SENSOR_PIN, INPUT_PULLUP);
+  
+  // Recover counters and pending events saved by a power-fail flush
+  PowerJournal journal;
+  bool recoveredFromPowerFail = restorePowerJournal(journal);
+  loadCorrelationRules();
+  loadEventFilters();
+  anomalyBaseline = nodeCounters; // Counts restored from the journal are not new activity
   
   // Initialize communication
+#if NODE_TRANSPORT_I2C
+  registerMap.id = I2C_MAP_VERSION;
+  Wire.begin(I2C_SLAVE_ADDRESS);
+  // Wire enables the internal pull-ups - the level shifter to the 3.3V Pico pulls each side up to its own rail
+  digitalWrite(SDA, LOW);
+  digitalWrite(SCL, LOW);
+  Wire.onReceive(onI2CReceive);
+  Wire.onRequest(onI2CRequest);
+#else
   picoSerial.begin(9600);
+  picoSerial.setTimeout(BULK_FRAME_TIMEOUT);
+#endif
   SPI.begin();
   rfidReader.PCD_Init();
   
@@ -110,6 +512,10 @@ void setup() {
   // Send ready status
   delay(1000); // Give Pico time to initialize
   sendMessage(MSG_STATUS_READY);
+  if (recoveredFromPowerFail) {
+    sendPowerFailReport(journal.vccMillivolts);
+  }
+  startPowerMonitor();
   DEBUG_PRINTLN(F("=== Arduino setup complete ==="));
 }
 
@@ -119,13 +525,48 @@ void loop() {
     uint8_t cmd = picoSerial.read();
     DEBUG_PRINT(F("Received command from Pico: "));
     DEBUG_PRINTLN(cmd);
-    processCommand(cmd);
+    if (cmd == CMD_BULK_DATA) {
+      receiveBulkChunk(); // Binary frame, not a newline-terminated payload
+      continue;
+    }
+    if (bulkSession.active) {
+      // The sender only streams frames during a session - anything else is a frame whose start byte
+      // was lost, and its body must not run as commands
+      resyncBulkTransfer();
+      continue;
+    }
+    char payload[17] = "";
+    if (commandHasPayload(cmd)) {
+      readCommandPayload(payload, sizeof(payload));
+    }
+    processCommand(cmd, payload);
   }
+
+#if NODE_TRANSPORT_I2C
+  // Apply actuator and command writes received from the I2C master
+  serviceRegisterMap();
+  refreshRegisterSnapshot();
+#endif
+  
+  // Report a supply dip that recovered without a reset
+  checkPowerRecovery();
   
   // Send periodic heartbeat
   unsigned long currentTime = millis();
+  serviceBulkTransfer(currentTime);
+  releaseHeldEvents();
+  reportAggregatedEvents(currentTime);
+  sampleAnomalyTrackers(currentTime);
+  
+  // Periodic reports are held back during a bulk transfer - SoftwareSerial cannot receive while sending
+  if (bulkSession.active) {
+    lastHeartbeat = currentTime;
+    lastMotionStatusReport = currentTime;
+  }
+  
   if (currentTime - lastHeartbeat >= heartbeatInterval) {
     sendMessage(MSG_HEARTBEAT);
+    nodeCounters.heartbeats++;
     lastHeartbeat = currentTime;
     DEBUG_PRINTLN(F("Heartbeat sent"));
   }
@@ -137,6 +578,9 @@ void loop() {
     DEBUG_PRINTLN(F("Motion status report sent"));
   }
   
+  // Duty cycle the reader field between scheduled polls
+  updateRfidPower(currentTime);
+  
   // If in RFID write mode, only handle RFID operations
   // This is to prevent other Alarm actions disturbing the write process which might result in a deadlock
   if (rfidWriteMode) {
@@ -168,8 +612,10 @@ void loop() {
   bool pirValue = digitalRead(MOTION_SENSOR_PIN);
   if (pirValue != lastPirValue) {
     lastMotionChange = currentTime;
+    nodeCounters.motionEvents++;
     if (pirValue == HIGH) {
       DEBUG_PRINTLN(F("Motion detected! Sending MSG_MOTION_DETECTED"));
+      noteCorrelationInput(INPUT_PIR, currentTime);
       sendMessage(MSG_MOTION_DETECTED);
     } else {
       DEBUG_PRINTLN(F("Motion stopped! Sending MSG_MOTION_STOPPED"));
@@ -186,52 +632,136 @@ void loop() {
   }
   lastButtonState = buttonState;
   
-  // RFID handling
-  if (rfidReader.PICC_IsNewCardPresent() && rfidReader.PICC_ReadCardSerial()) {
-    DEBUG_PRINTLN(F("RFID card detected! Processing card..."));
-    handleRFIDCard();
+  // Aux sensor handling - only feeds the correlation rules
+  bool auxActive = digitalRead(AUX_SENSOR_PIN) == LOW;
+  if (auxActive && !lastAuxActive) {
+    DEBUG_PRINTLN(F("Aux sensor triggered"));
+    noteCorrelationInput(INPUT_AUX, currentTime);
+  }
+  lastAuxActive = auxActive;
+  
+  // RFID handling - only while the field is up
+  if (rfidFieldOn && rfidReader.PICC_IsNewCardPresent() && rfidReader.PICC_ReadCardSerial()) {
+    // Dropping the field resets a halted card, so a card left on the reader shows up in every poll
+    // window - only treat it as a new tap once it has been absent for a whole poll period
+    uint32_t uidHash = hashCardUid();
+    unsigned long now = millis();
+    bool stillPresent = rfidDutyCycling() && uidHash == rfidPresentUid &&
+                        now - rfidPresentLastSeen <= rfidPollPeriod + rfidPollWindow;
+    rfidPresentUid = uidHash;
+    rfidPresentLastSeen = now;
+    
+    if (stillPresent) {
+      DEBUG_PRINTLN(F("RFID card still present, ignored"));
+    } else {
+      DEBUG_PRINTLN(F("RFID card detected! Processing card..."));
+      if (rfidDutyCycling()) {
+        rfidLastTapLatency = now - rfidWakeTime;
+      }
+      handleRFIDCard();
+    }
     rfidReader.PICC_HaltA();
     rfidReader.PCD_StopCrypto1();
   }
   
+  evaluateCorrelationRules(millis());
+  
   delay(50); // Small delay to prevent overwhelming the Pico
 }
 
 void sendMessage(MessageCode code) {
   DEBUG_PRINT(F("Sending message to Pico: "));
   DEBUG_PRINTLN(code);
-  picoSerial.write((uint8_t)code);
+  sendMessageWithData(code, NULL);
 }
 
 void sendMessageWithData(MessageCode code, const char* data) {
-  picoSerial.write((uint8_t)code);
-  picoSerial.print(':');
-  picoSerial.print(data);
-  picoSerial.write('\n');
+  if (!routeEvent(code)) return;
+  // Bulk replies are part of the transfer itself, everything else keeps its order behind held events
+  if (code == MSG_BULK_ACK || (!bulkSession.active && heldEventCount == 0)) {
+    if (transmitEvent((uint8_t)code, data)) return;
+  }
+  holdEvent((uint8_t)code, data);
 }
 
-void processCommand(uint8_t cmd) {
+bool sendMessageIfFree(MessageCode code, const char* data) {
+  // For reports the caller can retry - sent only when it needs no held slot, so they never crowd out alarm events
+  if (!routeEvent(code)) return true;
+  if (bulkSession.active || heldEventCount > 0) return false;
+  return transmitEvent((uint8_t)code, data);
+}
+
+bool transmitEvent(uint8_t code, const char* data) {
+#if NODE_TRANSPORT_I2C
+  return queueRegisterEvent(code, data);
+#else
+  picoSerial.write(code);
+  if (data != NULL) {
+    picoSerial.print(':');
+    picoSerial.print(data);
+    picoSerial.write('\n');
+  }
+  return true;
+#endif
+}
+
+void holdEvent(uint8_t code, const char* data) {
+  if (heldEventCount >= HELD_EVENT_COUNT) {
+    DEBUG_PRINTLN(F("Held events full - event dropped"));
+#if NODE_TRANSPORT_I2C
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      registerMap.flags |= FLAG_EVENT_OVERFLOW;
+    }
+#endif
+    return;
+  }
+  HeldEvent& held = heldEvents[heldEventCount++];
+  held.code = code;
+  held.hasData = data != NULL;
+  if (held.hasData) {
+    strncpy(held.data, data, sizeof(held.data) - 1);
+    held.data[sizeof(held.data) - 1] = '\0';
+  }
+}
+
+void releaseHeldEvents() {
+  if (bulkSession.active) return;
+  uint8_t sent = 0;
+  while (sent < heldEventCount &&
+         transmitEvent(heldEvents[sent].code, heldEvents[sent].hasData ? heldEvents[sent].data : NULL)) {
+    sent++;
+  }
+  if (sent == 0) return;
+  for (uint8_t i = sent; i < heldEventCount; i++) heldEvents[i - sent] = heldEvents[i];
+  heldEventCount -= sent;
+}
+
+bool commandHasPayload(uint8_t cmd) {
+  return cmd == CMD_SET_LED_RGB || cmd == CMD_RFID_WRITE_PREPARE || cmd == CMD_SET_RFID_DUTY ||
+         cmd == CMD_BULK_BEGIN || cmd == CMD_SET_FILTER || cmd == CMD_SET_ANOMALY;
+}
+
+void readCommandPayload(char* payload, size_t size) {
+  // Read the payload from the next bytes until newline
+  size_t i = 0;
+  while (i < size - 1 && picoSerial.available()) {
+    char c = picoSerial.read();
+    if (c == '\n' || c == '\0') break;
+    if (c == ':') continue; // Skip separator
+    payload[i++] = c;
+  }
+  payload[i] = '\0';
+}
+
+void processCommand(uint8_t cmd, const char* payload) {
   DEBUG_PRINT(F("Processing command: "));
   DEBUG_PRINTLN(cmd);
   
   switch (cmd) {
     case CMD_SET_LED_RGB:
-      DEBUG_PRINTLN(F("Setting LED RGB color, reading color data..."));
-      // Read the RGB data from the next bytes until newline
-      {
-        char rgbData[16] = "";
-        int i = 0;
-        while (i < 15 && picoSerial.available()) {
-          char c = picoSerial.read();
-          if (c == '\n' || c == '\0') break;
-          if (c == ':') continue; // Skip separator
-          rgbData[i++] = c;
-        }
-        rgbData[i] = '\0';
-        DEBUG_PRINT(F("RGB data received: "));
-        DEBUG_PRINTLN(rgbData);
-        parseAndSetRGB(rgbData);
-      }
+      DEBUG_PRINT(F("RGB data received: "));
+      DEBUG_PRINTLN(payload);
+      parseAndSetRGB(payload);
       break;
       
     case CMD_SET_BUZZER_ON:
@@ -243,22 +773,13 @@ void processCommand(uint8_t cmd) {
       break;
       
     case CMD_RFID_WRITE_PREPARE:
-      DEBUG_PRINTLN(F("Preparing for RFID write mode, reading secret key..."));
-      // Read the secret key from the next bytes until newline
-      {
-        int i = 0;
-        while (i < 16 && picoSerial.available()) {
-          char c = picoSerial.read();
-          if (c == '\n' || c == '\0') break;
-          if (c == ':') continue; // Skip separator
-          rfidWriteKey[i++] = c;
-        }
-        rfidWriteKey[i] = '\0';
-        rfidWritePrepared = true;
-        rfidWriteMode = false; // Not yet in active write mode
-        DEBUG_PRINT(F("RFID write prepared with key: "));
-        DEBUG_PRINTLN(rfidWriteKey);
-      }
+      DEBUG_PRINTLN(F("Preparing for RFID write mode, storing secret key..."));
+      strncpy(rfidWriteKey, payload, sizeof(rfidWriteKey) - 1);
+      rfidWriteKey[sizeof(rfidWriteKey) - 1] = '\0';
+      rfidWritePrepared = true;
+      rfidWriteMode = false; // Not yet in active write mode
+      DEBUG_PRINT(F("RFID write prepared with key: "));
+      DEBUG_PRINTLN(rfidWriteKey);
       break;
       
     case CMD_RFID_WRITE_CONFIRM:
@@ -288,24 +809,57 @@ void processCommand(uint8_t cmd) {
       sendStatusUpdate();
       break;
       
+    case CMD_SET_RFID_DUTY:
+      DEBUG_PRINT(F("RFID duty data received: "));
+      DEBUG_PRINTLN(payload);
+      parseAndSetRfidDuty(payload);
+      break;
+      
+    case CMD_BULK_BEGIN:
+      DEBUG_PRINT(F("Bulk transfer requested: "));
+      DEBUG_PRINTLN(payload);
+      beginBulkTransfer(payload);
+      break;
+      
+    case CMD_SET_FILTER:
+      DEBUG_PRINT(F("Filter data received: "));
+      DEBUG_PRINTLN(payload);
+      parseAndSetFilter(payload);
+      break;
+      
+    case CMD_SET_ANOMALY:
+      DEBUG_PRINT(F("Anomaly threshold received: "));
+      DEBUG_PRINTLN(payload);
+      parseAndSetAnomaly(payload);
+      break;
+      
     default:
+      // Most likely a corrupted byte on the link - the sender only uses known codes
       DEBUG_PRINT(F("Unknown command received: "));
       DEBUG_PRINTLN(cmd);
+      nodeCounters.linkErrors++;
       break;
   }
 }
 
 void handleRFIDCard() {
   DEBUG_PRINTLN(F("Handling RFID card..."));
+  if (!allowCardTap(millis())) {
+    DEBUG_PRINTLN(F("RFID tap rate limited, card ignored"));
+    return;
+  }
   sendMessage(MSG_RFID_DETECTED);
   
   char secretKey[17];
   if (readSecretKeyFromRFID(secretKey)) {
     DEBUG_PRINT(F("RFID read successful, secret key: "));
     DEBUG_PRINTLN(secretKey);
+    nodeCounters.rfidReads++;
     sendMessageWithData(MSG_RFID_READ_SUCCESS, secretKey);
   } else {
     DEBUG_PRINTLN(F("RFID read failed"));
+    nodeCounters.rfidFailures++;
+    noteCorrelationInput(INPUT_RFID_FAIL, millis());
     sendMessage(MSG_RFID_READ_FAILED);
   }
 }
@@ -443,6 +997,9 @@ void setLEDColor(int red, int green, int blue) {
   analogWrite(LED_PIN_RED, red);
   analogWrite(LED_PIN_GREEN, green);
   analogWrite(LED_PIN_BLUE, blue);
+  ledState[0] = red;
+  ledState[1] = green;
+  ledState[2] = blue;
 }
 
 void parseAndSetRGB(const char* rgbData) {
@@ -518,15 +1075,898 @@ void parseAndSetRGB(const char* rgbData) {
 }
 
 void sendStatusUpdate() {
+#if NODE_TRANSPORT_I2C
+  // The snapshot registers already carry the sensor states - only signal the update
+  refreshRegisterSnapshot();
+  sendMessage(MSG_STATUS_UPDATE);
+  return;
+#endif
   // Send status update with current sensor states
-  char statusData[64];
+  char statusData[96];
   bool currentPirValue = digitalRead(MOTION_SENSOR_PIN);
-  unsigned long timeSinceLastChange = millis() - lastMotionChange;
+  unsigned long now = millis();
+  unsigned long timeSinceLastChange = now - lastMotionChange;
+  unsigned long fieldOnTime = rfidFieldOnTotal + (rfidFieldOn ? now - rfidWakeTime : 0);
+  unsigned long fieldDuty = now > 0 ? (unsigned long)((fieldOnTime * 1000ULL) / now) : 1000;
   
-  snprintf(statusData, sizeof(statusData), "MOTION:%s,TIME:%lu", 
-           currentPirValue ? "ACTIVE" : "INACTIVE", timeSinceLastChange);
+  snprintf(statusData, sizeof(statusData), "MOTION:%s,TIME:%lu,RFON:%lu,RFDUTY:%lu,RFWAKE:%lu,RFTAP:%lu", 
+           currentPirValue ? "ACTIVE" : "INACTIVE", timeSinceLastChange,
+           fieldOnTime, fieldDuty, rfidLastWakeMicros, rfidLastTapLatency);
   
   sendMessageWithData(MSG_STATUS_UPDATE, statusData);
   DEBUG_PRINT(F("Status update sent: "));
   DEBUG_PRINTLN(statusData);
 }
+
+bool rfidDutyCycling() {
+  // Field stays up permanently in write mode or when the window covers the whole period
+  return !rfidWriteMode && rfidIdlePowerMode != RFID_POWER_ACTIVE && rfidPollWindow < rfidPollPeriod;
+}
+
+void setRfidField(bool on) {
+  if (on == rfidFieldOn) return;
+  
+  unsigned long now = millis();
+  if (on) {
+    unsigned long wakeStart = micros();
+    if (rfidIdlePowerMode == RFID_POWER_SOFT_DOWN) {
+      rfidReader.PCD_SoftPowerUp(); // Waits for the oscillator, antenna state is retained
+    } else {
+      rfidReader.PCD_AntennaOn();
+    }
+    rfidLastWakeMicros = micros() - wakeStart;
+    rfidWakeTime = now;
+  } else {
+    rfidFieldOnTotal += now - rfidWakeTime;
+    if (rfidIdlePowerMode == RFID_POWER_SOFT_DOWN) {
+      rfidReader.PCD_SoftPowerDown();
+    } else {
+      rfidReader.PCD_AntennaOff();
+    }
+  }
+  rfidFieldOn = on;
+}
+
+void updateRfidPower(unsigned long currentTime) {
+  if (!rfidDutyCycling()) {
+    setRfidField(true);
+    return;
+  }
+  
+  unsigned long sinceWake = currentTime - rfidWakeTime;
+  if (rfidFieldOn && sinceWake >= rfidPollWindow) {
+    setRfidField(false);
+  } else if (!rfidFieldOn && sinceWake >= rfidPollPeriod) {
+    setRfidField(true);
+  }
+}
+
+void parseAndSetRfidDuty(const char* dutyData) {
+  // Parse duty data in format "window,period,mode"
+  unsigned long window = 0, period = 0;
+  int mode = RFID_POWER_ACTIVE;
+  if (sscanf(dutyData, "%lu,%lu,%d", &window, &period, &mode) != 3 ||
+      mode < RFID_POWER_ACTIVE || mode > RFID_POWER_SOFT_DOWN || window == 0) {
+    DEBUG_PRINTLN(F("ERROR: Invalid RFID duty data"));
+    return;
+  }
+  
+  // Wake with the old mode before switching so the reader is never left in an unknown state
+  setRfidField(true);
+  rfidPollWindow = window;
+  rfidPollPeriod = period;
+  rfidIdlePowerMode = (RfidPowerMode)mode;
+  
+  DEBUG_PRINT(F("RFID duty set - window:"));
+  DEBUG_PRINT(rfidPollWindow);
+  DEBUG_PRINT(F(" period:"));
+  DEBUG_PRINT(rfidPollPeriod);
+  DEBUG_PRINT(F(" mode:"));
+  DEBUG_PRINTLN(mode);
+}
+
+void startPowerMonitor() {
+  // Measure the bandgap against AVcc - the reading rises as the supply falls
+  ADMUX = _BV(REFS0) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1);
+  ADCSRB = _BV(ADTS2); // Auto trigger on Timer0 overflow, shared with millis()
+  ADCSRA = _BV(ADEN) | _BV(ADATE) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+  DEBUG_PRINTLN(F("Power monitor started"));
+}
+
+ISR(ADC_vect) {
+  uint16_t reading = ADC;
+  vccReading = reading;
+  if (powerMonitorWarmup > 0) {
+    powerMonitorWarmup--;
+    return;
+  }
+  if (powerFailTripReading == 0) {
+    // The reading is inversely proportional to the supply, so a drop of p% raises it by 100/(100-p)
+    powerCalibrationSum += reading;
+    if (++powerCalibrationCount == POWER_CALIBRATION_SAMPLES) {
+      uint32_t baseline = powerCalibrationSum / POWER_CALIBRATION_SAMPLES;
+      powerRecoverReading = (baseline * 100UL) / (100 - POWER_RECOVER_DROP_PERCENT);
+      powerFailTripReading = (baseline * 100UL) / (100 - POWER_FAIL_DROP_PERCENT);
+    }
+    return;
+  }
+  if (!powerFailActive && reading >= powerFailTripReading) {
+    powerFailActive = true;
+    // Shed the LEDs to stretch the hold-up time. The buzzer may be sounding an alarm and is left on,
+    // SPI is left alone as loop() may own the bus
+    digitalWrite(LED_PIN_RED, LOW);
+    digitalWrite(LED_PIN_GREEN, LOW);
+    digitalWrite(LED_PIN_BLUE, LOW);
+    // A journal still valid from a recent dip covers this one, spares EEPROM on a dipping supply
+    if (!journalFlushed) {
+      flushPowerJournal(reading);
+      journalFlushed = true;
+      lastJournalFlush = millis();
+    }
+  }
+}
+
+void flushPowerJournal(uint16_t reading) {
+  // Runs in the ADC interrupt - EEPROM.update skips unchanged bytes to save hold-up time
+  PowerJournal journal;
+  memset(&journal, 0, sizeof(journal));
+#if NODE_TRANSPORT_I2C
+  journal.pendingCount = registerMap.eventCount;
+  for (uint8_t i = 0; i < journal.pendingCount; i++) journal.pendingEvents[i] = registerMap.events[i];
+#endif
+  journal.counters = nodeCounters;
+  journal.powerFailures = powerFailures + 1;
+  journal.vccMillivolts = (BANDGAP_MV * 1023UL) / reading;
+  journal.valid = JOURNAL_VALID;
+
+  const uint8_t* bytes = (const uint8_t*)&journal;
+  for (uint8_t i = 0; i < sizeof(journal); i++) {
+    EEPROM.update(EEPROM_JOURNAL_ADDR + i, bytes[i]);
+  }
+}
+
+bool restorePowerJournal(PowerJournal& journal) {
+  EEPROM.get(EEPROM_JOURNAL_ADDR, journal);
+  if (journal.valid != JOURNAL_VALID) {
+    return false;
+  }
+
+  DEBUG_PRINTLN(F("Recovering from power fail journal"));
+  nodeCounters = journal.counters;
+  powerFailures = journal.powerFailures;
+#if NODE_TRANSPORT_I2C
+  // Payload-carrying events are dropped - their data was not journaled and would be stale anyway
+  for (uint8_t i = 0; i < journal.pendingCount && i < I2C_EVENT_FIFO_SIZE; i++) {
+    if (!(journal.pendingEvents[i] & I2C_EVENT_HAS_PAYLOAD)) {
+      queueRegisterEvent(journal.pendingEvents[i], NULL);
+    }
+  }
+#endif
+  EEPROM.update(EEPROM_JOURNAL_ADDR + offsetof(PowerJournal, valid), 0);
+  return true;
+}
+
+void checkPowerRecovery() {
+  if (powerFailActive) {
+    uint16_t reading, recoverReading;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      reading = vccReading;
+      recoverReading = powerRecoverReading;
+    }
+    if (reading == 0 || reading > recoverReading) return;
+    
+    DEBUG_PRINTLN(F("Supply recovered from power fail"));
+    powerFailures++;
+    setLEDColor(ledState[0], ledState[1], ledState[2]);
+    pendingPowerFailMv = (BANDGAP_MV * 1023UL) / reading;
+    powerFailReportPending = true;
+    powerFailActive = false;
+  }
+  
+  // Supply held since the last flush - the journal is not needed for the next boot. It is only
+  // invalidated once the next dip is allowed to flush again, so a valid journal is always on disk
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (journalFlushed && !powerFailActive && millis() - lastJournalFlush >= POWER_FAIL_REFLUSH_MS) {
+      EEPROM.update(EEPROM_JOURNAL_ADDR + offsetof(PowerJournal, valid), 0);
+      journalFlushed = false;
+    }
+  }
+  
+  // Repeated dips are folded into the FAILS count of the next report
+  if (powerFailReportPending && (!powerFailReported || millis() - lastPowerFailReport >= POWER_FAIL_REPORT_MS)) {
+    sendPowerFailReport(pendingPowerFailMv);
+  }
+}
+
+void sendPowerFailReport(uint16_t vccMillivolts) {
+  powerFailReportPending = false;
+  powerFailReported = true;
+  lastPowerFailReport = millis();
+  char powerData[32];
+  snprintf(powerData, sizeof(powerData), "FAILS:%u,VCC:%u", powerFailures, vccMillivolts);
+  sendMessageWithData(MSG_POWER_FAIL, powerData);
+  DEBUG_PRINT(F("Power fail report sent: "));
+  DEBUG_PRINTLN(powerData);
+}
+
+bool eepromUpdate(int address, uint8_t value) {
+  // Regular EEPROM writers back off once the supply is failing so the journal flush gets the hold-up time
+  if (powerFailActive) return false;
+  EEPROM.update(address, value);
+  return true;
+}
+
+uint16_t crc16Update(uint16_t crc, uint8_t data) {
+  // CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), matches crc16_ccitt() on the Pico
+  crc ^= (uint16_t)data << 8;
+  for (uint8_t i = 0; i < 8; i++) {
+    crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+bool bulkRegionFor(uint8_t target, uint16_t& address, uint16_t& size) {
+  switch (target) {
+    case BULK_TARGET_CONFIG:
+      address = EEPROM_CONFIG_ADDR;
+      size = EEPROM_CONFIG_SIZE;
+      return true;
+    case BULK_TARGET_ALLOWLIST:
+      address = EEPROM_ALLOWLIST_ADDR;
+      size = EEPROM_ALLOWLIST_SIZE;
+      return true;
+    case BULK_TARGET_RULES:
+      address = EEPROM_RULES_ADDR;
+      size = EEPROM_RULES_SIZE;
+      return true;
+    default:
+      return false;
+  }
+}
+
+void beginBulkTransfer(const char* bulkData) {
+#if NODE_TRANSPORT_I2C
+  // Chunks arrive as binary frames on the UART stream, which the I2C transport does not use
+  sendBulkReply("ERR_TRANSPORT", 0);
+  return;
+#endif
+  // Parse bulk data in format "target,length,crc"
+  unsigned int target = 0, length = 0, crc = 0;
+  uint16_t address, size;
+  if (sscanf(bulkData, "%u,%u,%u", &target, &length, &crc) != 3 || !bulkRegionFor(target, address, size)) {
+    sendBulkReply("ERR_TARGET", target);
+    return;
+  }
+  if (length == 0 || length > (unsigned int)(size - BULK_HEADER_SIZE)) {
+    sendBulkReply("ERR_SIZE", length);
+    return;
+  }
+  // A rules blob loadCorrelationRules() cannot take whole would be committed and then ignored
+  if (target == BULK_TARGET_RULES &&
+      (length > sizeof(correlationRules) || length % sizeof(CorrelationRule) != 0)) {
+    sendBulkReply("ERR_SIZE", length);
+    return;
+  }
+  
+  // Invalidate the stored blob until the new one is complete and verified
+  if (!eepromUpdate(address, 0xFF) || !eepromUpdate(address + 1, 0xFF)) {
+    sendBulkReply("ERR_POWER", 0);
+    return;
+  }
+  
+  bulkSession.active = true;
+  bulkSession.target = target;
+  bulkSession.regionAddress = address;
+  bulkSession.length = length;
+  bulkSession.expectedCrc = crc;
+  bulkSession.nextOffset = 0;
+  bulkSession.runningCrc = 0xFFFF;
+  bulkSession.framesSinceAck = 0;
+  bulkSession.lastActivity = millis();
+  sendBulkReply("ACK", 0);
+}
+
+void receiveBulkChunk() {
+  // Frame after the command byte: offset (uint16 LE), length (uint8), data, CRC-16 (LE) over offset..data
+  uint8_t frame[3 + BULK_CHUNK_SIZE + 2];
+  if (picoSerial.readBytes(frame, 3) != 3) {
+    resyncBulkTransfer();
+    return;
+  }
+  uint16_t offset = frame[0] | ((uint16_t)frame[1] << 8);
+  uint8_t length = frame[2];
+  if (length == 0 || length > BULK_CHUNK_SIZE || picoSerial.readBytes(frame + 3, length + 2) != (size_t)(length + 2)) {
+    resyncBulkTransfer();
+    return;
+  }
+  
+  uint16_t crc = 0xFFFF;
+  for (uint8_t i = 0; i < 3 + length; i++) crc = crc16Update(crc, frame[i]);
+  uint16_t frameCrc = frame[3 + length] | ((uint16_t)frame[4 + length] << 8);
+  if (crc != frameCrc) {
+    DEBUG_PRINTLN(F("Bulk chunk CRC error"));
+    resyncBulkTransfer();
+    return;
+  }
+  if (!bulkSession.active) return;
+  
+  bulkSession.lastActivity = millis();
+  bulkSession.framesSinceAck++;
+  
+  // Only the next in-order chunk is accepted (go-back-N), duplicates are just counted towards the window
+  if (offset == bulkSession.nextOffset && offset + length <= bulkSession.length) {
+    uint16_t address = bulkSession.regionAddress + BULK_HEADER_SIZE + offset;
+    for (uint8_t i = 0; i < length; i++) {
+      if (!eepromUpdate(address + i, frame[3 + i])) {
+        bulkSession.active = false;
+        sendBulkReply("ERR_POWER", 0);
+        return;
+      }
+      bulkSession.runningCrc = crc16Update(bulkSession.runningCrc, frame[3 + i]);
+    }
+    bulkSession.nextOffset += length;
+    
+    if (bulkSession.nextOffset == bulkSession.length) {
+      finishBulkTransfer();
+      return;
+    }
+  }
+  
+  if (bulkSession.framesSinceAck >= BULK_WINDOW_CHUNKS) {
+    sendBulkReply("ACK", bulkSession.nextOffset);
+  }
+}
+
+void resyncBulkTransfer() {
+  // Drop the rest of a corrupted window until the sender goes quiet, then ask for a resend
+  nodeCounters.linkErrors++;
+  unsigned long idleStart = millis();
+  while (millis() - idleStart < BULK_RESYNC_IDLE_MS) {
+    if (picoSerial.available()) {
+      picoSerial.read();
+      idleStart = millis();
+    }
+  }
+  if (bulkSession.active) {
+    bulkSession.lastActivity = millis();
+    sendBulkReply("ACK", bulkSession.nextOffset);
+  }
+}
+
+void sendBulkReply(const char* status, unsigned int value) {
+  char bulkData[20];
+  snprintf(bulkData, sizeof(bulkData), "%s:%u", status, value);
+  bulkSession.framesSinceAck = 0;
+  sendMessageWithData(MSG_BULK_ACK, bulkData);
+  DEBUG_PRINT(F("Bulk reply sent: "));
+  DEBUG_PRINTLN(bulkData);
+}
+
+void finishBulkTransfer() {
+  bulkSession.active = false;
+  if (bulkSession.runningCrc != bulkSession.expectedCrc) {
+    DEBUG_PRINTLN(F("Bulk transfer failed - blob CRC mismatch"));
+    nodeCounters.linkErrors++;
+    sendBulkReply("ERR_CRC", bulkSession.target);
+    return;
+  }
+  
+  // Commit by writing the header last
+  uint16_t address = bulkSession.regionAddress;
+  if (!eepromUpdate(address + 2, lowByte(bulkSession.runningCrc)) ||
+      !eepromUpdate(address + 3, highByte(bulkSession.runningCrc)) ||
+      !eepromUpdate(address, lowByte(bulkSession.length)) ||
+      !eepromUpdate(address + 1, highByte(bulkSession.length))) {
+    sendBulkReply("ERR_POWER", 0);
+    return;
+  }
+  DEBUG_PRINTLN(F("Bulk transfer committed"));
+  sendBulkReply("DONE", bulkSession.target);
+  
+  if (bulkSession.target == BULK_TARGET_RULES) {
+    loadCorrelationRules();
+  }
+}
+
+uint16_t readBulkBlob(uint8_t target, uint8_t* buffer, uint16_t maxLength) {
+  // Returns the length of the committed blob, or 0 if there is none, it does not fit or its CRC is bad
+  uint16_t address, size;
+  if (!bulkRegionFor(target, address, size)) return 0;
+  
+  uint16_t length = EEPROM.read(address) | ((uint16_t)EEPROM.read(address + 1) << 8);
+  uint16_t storedCrc = EEPROM.read(address + 2) | ((uint16_t)EEPROM.read(address + 3) << 8);
+  if (length == 0 || length > size - BULK_HEADER_SIZE || length > maxLength) return 0;
+  
+  uint16_t crc = 0xFFFF;
+  for (uint16_t i = 0; i < length; i++) {
+    buffer[i] = EEPROM.read(address + BULK_HEADER_SIZE + i);
+    crc = crc16Update(crc, buffer[i]);
+  }
+  return crc == storedCrc ? length : 0;
+}
+
+void loadCorrelationRules() {
+  uint16_t length = readBulkBlob(BULK_TARGET_RULES, (uint8_t*)correlationRules, sizeof(correlationRules));
+  if (length > 0 && length % sizeof(CorrelationRule) == 0) {
+    correlationRuleCount = length / sizeof(CorrelationRule);
+    DEBUG_PRINT(F("Loaded correlation rules: "));
+  } else {
+    memcpy(correlationRules, defaultCorrelationRules, sizeof(defaultCorrelationRules));
+    correlationRuleCount = sizeof(defaultCorrelationRules) / sizeof(CorrelationRule);
+    DEBUG_PRINT(F("Using default correlation rules: "));
+  }
+  DEBUG_PRINTLN(correlationRuleCount);
+  
+  // Edges seen before the reload must not fire the new rules
+  for (uint8_t i = 0; i < correlationRuleCount; i++) {
+    ruleLastFired[i] = millis();
+  }
+}
+
+void noteCorrelationInput(uint8_t input, unsigned long currentTime) {
+  inputLastEdge[input] = currentTime;
+  inputSeen |= 1 << input;
+}
+
+void evaluateCorrelationRules(unsigned long currentTime) {
+  for (uint8_t i = 0; i < correlationRuleCount; i++) {
+    const CorrelationRule& rule = correlationRules[i];
+    if (rule.first >= CORRELATION_INPUT_COUNT || rule.second >= CORRELATION_INPUT_COUNT) continue;
+    if (!(inputSeen & (1 << rule.first)) || !(inputSeen & (1 << rule.second))) continue;
+    
+    // Ages rather than timestamps keep the comparison valid across millis() rollover
+    unsigned long firstAge = currentTime - inputLastEdge[rule.first];
+    unsigned long secondAge = currentTime - inputLastEdge[rule.second];
+    unsigned long newestAge = min(firstAge, secondAge);
+    unsigned long delta = firstAge > secondAge ? firstAge - secondAge : secondAge - firstAge;
+    
+    if (delta > rule.windowMs) continue;
+    if ((rule.flags & RULE_ORDERED) && firstAge < secondAge) continue;
+    if (newestAge >= currentTime - ruleLastFired[i]) continue; // Already reported for these edges
+    
+    ruleLastFired[i] = currentTime - newestAge;
+    char ruleData[16];
+    snprintf(ruleData, sizeof(ruleData), "%u,%lu", i, delta);
+    DEBUG_PRINT(F("Intrusion confirmed by rule: "));
+    DEBUG_PRINTLN(ruleData);
+    sendMessageWithData(MSG_INTRUSION_CONFIRMED, ruleData);
+  }
+}
+
+void serviceBulkTransfer(unsigned long currentTime) {
+  if (!bulkSession.active) return;
+  
+  unsigned long idle = currentTime - bulkSession.lastActivity;
+  if (idle >= BULK_SESSION_TIMEOUT) {
+    DEBUG_PRINTLN(F("Bulk transfer timed out"));
+    bulkSession.active = false;
+    sendBulkReply("ERR_TIMEOUT", bulkSession.nextOffset);
+  } else if (bulkSession.framesSinceAck > 0 && idle >= BULK_IDLE_ACK_MS) {
+    // Last frames of a window were lost - report progress so the sender resends from there
+    sendBulkReply("ACK", bulkSession.nextOffset);
+  }
+}
+
+uint32_t hashCardUid() {
+  // FNV-1a over the full UID - 4, 7 and 10 byte UIDs share one table
+  uint32_t hash = 2166136261UL;
+  for (byte i = 0; i < rfidReader.uid.size; i++) {
+    hash = (hash ^ rfidReader.uid.uidByte[i]) * 16777619UL;
+  }
+  return hash != 0 ? hash : 1;
+}
+
+bool allowCardTap(unsigned long currentTime) {
+  uint32_t uidHash = hashCardUid();
+  
+  // Find the card, otherwise take a free slot or evict the least recently seen card,
+  // preferring cards that are not locked out so a lockout cannot be shaken off by tapping others
+  UidRateEntry* entry = NULL;
+  UidRateEntry* victim = NULL;
+  bool victimLocked = true;
+  for (uint8_t i = 0; i < RATE_LIMIT_TABLE_SIZE; i++) {
+    UidRateEntry& candidate = uidRateTable[i];
+    if (candidate.uidHash == uidHash) {
+      entry = &candidate;
+      break;
+    }
+    if (victim != NULL && victim->uidHash == 0) continue;
+    bool locked = candidate.lockoutDuration > 0 && currentTime - candidate.lockoutStart < candidate.lockoutDuration;
+    if (candidate.uidHash == 0 || victim == NULL || (victimLocked && !locked) ||
+        (victimLocked == locked && currentTime - candidate.lastSeen > currentTime - victim->lastSeen)) {
+      victim = &candidate;
+      victimLocked = locked;
+    }
+  }
+  if (entry == NULL) {
+    entry = victim;
+    memset(entry, 0, sizeof(UidRateEntry));
+    entry->uidHash = uidHash;
+    entry->tokens = RATE_LIMIT_BURST;
+    entry->lastRefill = currentTime;
+  }
+  entry->lastSeen = currentTime;
+  
+  // Still locked out - drop the tap silently, it was reported when the lockout started
+  if (entry->lockoutDuration > 0) {
+    if (currentTime - entry->lockoutStart < entry->lockoutDuration) {
+      return false;
+    }
+    // Lockout over - let one tap through, a stuck card escalates again on the next one
+    entry->lockoutDuration = 0;
+    entry->tokens = 1;
+    entry->lastRefill = currentTime;
+  }
+  
+  // Forget old violations
+  if (entry->lockoutLevel > 0 && currentTime - entry->lockoutStart >= RATE_LIMIT_FORGIVE_MS) {
+    entry->lockoutLevel = 0;
+  }
+  
+  // Refill the bucket
+  unsigned long refills = (currentTime - entry->lastRefill) / RATE_LIMIT_REFILL_MS;
+  if (refills > 0) {
+    entry->tokens = min((unsigned long)RATE_LIMIT_BURST, entry->tokens + refills);
+    entry->lastRefill += refills * RATE_LIMIT_REFILL_MS;
+  }
+  
+  if (entry->tokens > 0) {
+    if (!takeReaderToken(currentTime)) return false; // The card keeps its token
+    entry->tokens--;
+    return true;
+  }
+  
+  // Bucket empty - escalate the lockout
+  if (entry->lockoutLevel < RATE_LIMIT_MAX_LEVEL) entry->lockoutLevel++;
+  entry->lockoutStart = currentTime;
+  entry->lockoutDuration = RATE_LIMIT_LOCKOUT_MS << (entry->lockoutLevel - 1);
+  sendRateLimitedEvent(entry->lockoutDuration);
+  noteCorrelationInput(INPUT_RATE_LIMIT, currentTime);
+  return false;
+}
+
+bool takeReaderToken(unsigned long currentTime) {
+  // Per-reader bucket behind the per-UID table - bounds backend load whatever is held to the reader
+  unsigned long refills = (currentTime - readerLastRefill) / RATE_LIMIT_READER_REFILL_MS;
+  if (refills > 0) {
+    readerTokens = min((unsigned long)RATE_LIMIT_READER_BURST, readerTokens + refills);
+    readerLastRefill += refills * RATE_LIMIT_READER_REFILL_MS;
+  }
+  
+  if (readerTokens > 0) {
+    readerTokens--;
+    readerLimitReported = false;
+    return true;
+  }
+  
+  // Reported once per exhaustion, not for every tap while the reader is saturated
+  if (!readerLimitReported) {
+    readerLimitReported = true;
+    sendRateLimitedEvent(RATE_LIMIT_READER_REFILL_MS);
+    noteCorrelationInput(INPUT_RATE_LIMIT, currentTime);
+  }
+  return false;
+}
+
+void sendRateLimitedEvent(unsigned long lockoutDuration) {
+  // Lockout seconds first so a truncated I2C payload only loses the end of the UID
+  char rateData[32];
+  int length = snprintf(rateData, sizeof(rateData), "%lu,", lockoutDuration / 1000);
+  for (byte i = 0; i < rfidReader.uid.size && length < (int)sizeof(rateData) - 2; i++) {
+    length += snprintf(rateData + length, sizeof(rateData) - length, "%02X", rfidReader.uid.uidByte[i]);
+  }
+  sendMessageWithData(MSG_RFID_RATE_LIMITED, rateData);
+  DEBUG_PRINT(F("RFID rate limited: "));
+  DEBUG_PRINTLN(rateData);
+}
+
+void loadEventFilters() {
+  FilterTableHeader header;
+  EEPROM.get(EEPROM_FILTER_HEADER_ADDR, header);
+  EEPROM.get(EEPROM_FILTER_ADDR, eventFilters);
+  if (header.valid != FILTER_TABLE_VALID || header.crc != eventFilterCrc()) {
+    DEBUG_PRINTLN(F("No valid filter table - forwarding all events"));
+    memset(eventFilters, FILTER_EMPTY, sizeof(eventFilters));
+  }
+  memset(filterAggregateCounts, 0, sizeof(filterAggregateCounts));
+}
+
+uint16_t eventFilterCrc() {
+  const uint8_t* bytes = (const uint8_t*)eventFilters;
+  uint16_t crc = 0xFFFF;
+  for (uint8_t i = 0; i < sizeof(eventFilters); i++) crc = crc16Update(crc, bytes[i]);
+  return crc;
+}
+
+void parseAndSetFilter(const char* filterData) {
+  // Parse filter data in format "slot,code,zone,reader,action" - action 255 clears the slot
+  unsigned int slot, code, zone, reader, action;
+  if (sscanf(filterData, "%u,%u,%u,%u,%u", &slot, &code, &zone, &reader, &action) != 5 ||
+      slot >= FILTER_TABLE_SIZE || code > 255 || zone > 255 || reader > 255 ||
+      (action > FILTER_AGGREGATE && action != FILTER_EMPTY)) {
+    DEBUG_PRINTLN(F("ERROR: Invalid filter data"));
+    return;
+  }
+  
+  EventFilter& filter = eventFilters[slot];
+  filter.code = code;
+  filter.zone = zone;
+  filter.reader = reader;
+  filter.action = action;
+  filterAggregateCounts[slot] = 0;
+  
+  // Invalidate, write the whole table (it may have loaded as empty), then commit CRC and marker -
+  // an interrupted update reads back as an empty table. EEPROM.update skips unchanged bytes.
+  if (!eepromUpdate(EEPROM_FILTER_HEADER_ADDR + offsetof(FilterTableHeader, valid), 0)) return;
+  const uint8_t* bytes = (const uint8_t*)eventFilters;
+  for (uint8_t i = 0; i < sizeof(eventFilters); i++) {
+    eepromUpdate(EEPROM_FILTER_ADDR + i, bytes[i]);
+  }
+  uint16_t crc = eventFilterCrc();
+  eepromUpdate(EEPROM_FILTER_HEADER_ADDR + offsetof(FilterTableHeader, crc), crc & 0xFF);
+  eepromUpdate(EEPROM_FILTER_HEADER_ADDR + offsetof(FilterTableHeader, crc) + 1, crc >> 8);
+  eepromUpdate(EEPROM_FILTER_HEADER_ADDR + offsetof(FilterTableHeader, valid), FILTER_TABLE_VALID);
+  DEBUG_PRINT(F("Filter slot set: "));
+  DEBUG_PRINTLN(slot);
+}
+
+bool routeEvent(uint8_t code) {
+  // Control messages always go out - the gateway depends on them for link supervision
+  if (code == MSG_STATUS_READY || code == MSG_HEARTBEAT || code == MSG_BULK_ACK || code == MSG_EVENT_AGGREGATE) {
+    return true;
+  }
+  
+  uint8_t zone = 0, reader = 0;
+  switch (code) {
+    case MSG_MOTION_DETECTED:
+    case MSG_MOTION_STOPPED:
+      zone = ZONE_PIR;
+      break;
+    case MSG_RFID_DETECTED:
+    case MSG_RFID_READ_SUCCESS:
+    case MSG_RFID_READ_FAILED:
+    case MSG_RFID_WRITE_SUCCESS:
+    case MSG_RFID_WRITE_FAILED:
+    case MSG_RFID_WRITE_COMPLETED:
+    case MSG_RFID_RATE_LIMITED:
+      reader = READER_MAIN;
+      break;
+    default:
+      break;
+  }
+  
+  for (uint8_t i = 0; i < FILTER_TABLE_SIZE; i++) {
+    const EventFilter& filter = eventFilters[i];
+    if (filter.action == FILTER_EMPTY) continue;
+    if ((filter.code != 0 && filter.code != code) ||
+        (filter.zone != 0 && filter.zone != zone) ||
+        (filter.reader != 0 && filter.reader != reader)) continue;
+    
+    if (filter.action == FILTER_AGGREGATE && filterAggregateCounts[i] < 0xFFFF) {
+      filterAggregateCounts[i]++;
+    }
+    return filter.action == FILTER_FORWARD;
+  }
+  return true;
+}
+
+void reportAggregatedEvents(unsigned long currentTime) {
+  if (bulkSession.active || currentTime - lastAggregateReport < FILTER_AGGREGATE_INTERVAL) return;
+  
+  // A count is only cleared once its report is out - on I2C the mailbox takes one report per master poll,
+  // the remaining slots are retried on the following passes
+  for (uint8_t i = 0; i < FILTER_TABLE_SIZE; i++) {
+    if (filterAggregateCounts[i] == 0) continue;
+    char aggregateData[16];
+    snprintf(aggregateData, sizeof(aggregateData), "%u,%u", i, filterAggregateCounts[i]);
+    if (!sendMessageIfFree(MSG_EVENT_AGGREGATE, aggregateData)) return;
+    filterAggregateCounts[i] = 0;
+  }
+  lastAggregateReport = currentTime;
+}
+
+void parseAndSetAnomaly(const char* anomalyData) {
+  // Parse threshold data in format "tracker,threshold" - threshold 0 disables the tracker
+  unsigned int tracker, threshold;
+  if (sscanf(anomalyData, "%u,%u", &tracker, &threshold) != 2 || tracker >= ANOMALY_TRACKER_COUNT) {
+    DEBUG_PRINTLN(F("ERROR: Invalid anomaly threshold data"));
+    return;
+  }
+  
+  anomalyThresholds[tracker] = threshold;
+  anomalyActive &= ~(1 << tracker); // Alerts again on the next sample if already above the new threshold
+  DEBUG_PRINT(F("Anomaly threshold set for tracker: "));
+  DEBUG_PRINTLN(tracker);
+}
+
+uint8_t counterGrowth(uint16_t current, uint16_t baseline) {
+  // Unsigned difference copes with counter rollover, buckets saturate at 255 per sample
+  uint16_t growth = current - baseline;
+  return growth > 255 ? 255 : growth;
+}
+
+void sampleAnomalyTrackers(unsigned long currentTime) {
+  // Paused during a bulk transfer - growth is taken against the baseline, so errors raised meanwhile land in the next sample
+  if (bulkSession.active || currentTime - lastAnomalySample < ANOMALY_SAMPLE_MS) return;
+  lastAnomalySample = currentTime;
+  
+  AnomalyBucket& bucket = anomalyBuckets[anomalyBucketIndex];
+  bucket.rfidReads = counterGrowth(nodeCounters.rfidReads, anomalyBaseline.rfidReads);
+  bucket.rfidFailures = counterGrowth(nodeCounters.rfidFailures, anomalyBaseline.rfidFailures);
+  bucket.motionEvents = counterGrowth(nodeCounters.motionEvents, anomalyBaseline.motionEvents);
+  bucket.linkErrors = counterGrowth(nodeCounters.linkErrors, anomalyBaseline.linkErrors);
+  anomalyBaseline = nodeCounters;
+  anomalyBucketIndex = (anomalyBucketIndex + 1) % ANOMALY_BUCKETS;
+  
+  uint16_t reads = 0, failures = 0, motionEvents = 0, linkErrors = 0;
+  for (uint8_t i = 0; i < ANOMALY_BUCKETS; i++) {
+    reads += anomalyBuckets[i].rfidReads;
+    failures += anomalyBuckets[i].rfidFailures;
+    motionEvents += anomalyBuckets[i].motionEvents;
+    linkErrors += anomalyBuckets[i].linkErrors;
+  }
+  
+  uint16_t rates[ANOMALY_TRACKER_COUNT];
+  uint16_t attempts = reads + failures;
+  rates[ANOMALY_RFID_FAILURES] = attempts >= ANOMALY_MIN_READS ? (uint16_t)((failures * 100UL) / attempts) : 0;
+  rates[ANOMALY_PIR_CHATTER] = motionEvents;
+  rates[ANOMALY_LINK_ERRORS] = linkErrors;
+  
+  for (uint8_t i = 0; i < ANOMALY_TRACKER_COUNT; i++) {
+    bool above = anomalyThresholds[i] != 0 && rates[i] >= anomalyThresholds[i];
+    if (above && !(anomalyActive & (1 << i))) {
+      char alertData[20];
+      snprintf(alertData, sizeof(alertData), "%u,%u,%u", i, rates[i], anomalyThresholds[i]);
+      DEBUG_PRINT(F("Counter anomaly: "));
+      DEBUG_PRINTLN(alertData);
+      sendMessageWithData(MSG_ANOMALY_ALERT, alertData);
+    }
+    if (above) {
+      anomalyActive |= 1 << i;
+    } else {
+      anomalyActive &= ~(1 << i);
+    }
+  }
+}
+
+#if NODE_TRANSPORT_I2C
+void onI2CReceive(int byteCount) {
+  // Runs in the TWI interrupt - only touch the register map and pending flags here
+  if (byteCount < 1) return;
+  registerPointer = Wire.read();
+  byteCount--;
+
+  if (registerPointer == REG_COMMAND) {
+    if (byteCount < 1 || pendingCommandReady) {
+      while (Wire.available()) Wire.read(); // Previous command not yet handled (FLAG_COMMAND_BUSY), drop this one
+      return;
+    }
+    pendingCommand = Wire.read();
+    uint8_t i = 0;
+    while (Wire.available()) {
+      char c = Wire.read();
+      if (i < I2C_PAYLOAD_SIZE && c != '\n' && c != ':') pendingCommandPayload[i++] = c;
+    }
+    pendingCommandPayload[i] = '\0';
+    pendingCommandReady = true;
+    registerMap.flags |= FLAG_COMMAND_BUSY;
+    return;
+  }
+
+  while (Wire.available()) {
+    uint8_t value = Wire.read();
+    switch (registerPointer) {
+      case REG_LED_RED:
+      case REG_LED_GREEN:
+      case REG_LED_BLUE:
+      case REG_BUZZER:
+        ((volatile uint8_t*)&registerMap)[registerPointer] = value;
+        actuatorsDirty = true;
+        break;
+
+      case REG_EVENT_ACK: {
+        uint8_t count = min(value, registerMap.eventCount);
+        for (uint8_t i = count; i < registerMap.eventCount; i++) {
+          registerMap.events[i - count] = registerMap.events[i];
+        }
+        registerMap.eventCount -= count;
+        registerMap.flags &= ~FLAG_EVENT_OVERFLOW;
+        break;
+      }
+
+      default:
+        break; // Read only register
+    }
+    registerPointer++;
+  }
+}
+
+void onI2CRequest() {
+  // Burst read from the register pointer, bounded by the Wire buffer
+  if (registerPointer >= sizeof(NodeRegisterMap)) {
+    Wire.write((uint8_t)0);
+    return;
+  }
+  uint8_t length = min(sizeof(NodeRegisterMap) - registerPointer, (size_t)32);
+  Wire.write((const uint8_t*)&registerMap + registerPointer, length);
+}
+
+bool queueRegisterEvent(uint8_t code, const char* data) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    bool queued = registerMap.eventCount < I2C_EVENT_FIFO_SIZE;
+    if (queued && data != NULL) {
+      // Single mailbox - a second payload-carrying event waits with the held events until the master acks the first
+      for (uint8_t i = 0; i < registerMap.eventCount; i++) {
+        if (registerMap.events[i] & I2C_EVENT_HAS_PAYLOAD) queued = false;
+      }
+    }
+    if (!queued) return false;
+    if (data != NULL) {
+      uint8_t length = min(strlen(data), (size_t)I2C_PAYLOAD_SIZE);
+      for (uint8_t i = 0; i < length; i++) registerMap.payload[i] = data[i];
+      registerMap.payloadLength = length;
+      code |= I2C_EVENT_HAS_PAYLOAD;
+    }
+    registerMap.events[registerMap.eventCount++] = code;
+  }
+  return true;
+}
+
+void refreshRegisterSnapshot() {
+  uint8_t flags = 0;
+  if (digitalRead(MOTION_SENSOR_PIN) == HIGH) flags |= FLAG_MOTION;
+  if (lastButtonState == LOW) flags |= FLAG_BUTTON;
+  if (rfidWriteMode) flags |= FLAG_RFID_WRITE_MODE;
+  if (rfidWritePrepared) flags |= FLAG_RFID_WRITE_PREPARED;
+  if (digitalRead(BUZZER_PIN) == HIGH) flags |= FLAG_BUZZER;
+  unsigned long motionAge = millis() - lastMotionChange;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    registerMap.flags = (registerMap.flags & (FLAG_EVENT_OVERFLOW | FLAG_COMMAND_BUSY)) | flags;
+    registerMap.motionAge = motionAge;
+    registerMap.counters.motionEvents = nodeCounters.motionEvents;
+    registerMap.counters.rfidReads = nodeCounters.rfidReads;
+    registerMap.counters.rfidFailures = nodeCounters.rfidFailures;
+    registerMap.counters.heartbeats = nodeCounters.heartbeats;
+    registerMap.counters.linkErrors = nodeCounters.linkErrors;
+    if (!actuatorsDirty) {
+      registerMap.ledRed = ledState[0];
+      registerMap.ledGreen = ledState[1];
+      registerMap.ledBlue = ledState[2];
+      registerMap.buzzer = digitalRead(BUZZER_PIN);
+    }
+  }
+}
+
+void serviceRegisterMap() {
+  if (actuatorsDirty) {
+    uint8_t red, green, blue, buzzer;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      red = registerMap.ledRed;
+      green = registerMap.ledGreen;
+      blue = registerMap.ledBlue;
+      buzzer = registerMap.buzzer;
+      actuatorsDirty = false;
+    }
+    DEBUG_PRINTLN(F("Applying actuator registers from I2C master"));
+    setLEDColor(red, green, blue);
+    digitalWrite(BUZZER_PIN, buzzer ? HIGH : LOW);
+  }
+
+  if (pendingCommandReady) {
+    uint8_t cmd;
+    char payload[I2C_PAYLOAD_SIZE + 1];
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      cmd = pendingCommand;
+      for (uint8_t i = 0; i <= I2C_PAYLOAD_SIZE; i++) payload[i] = pendingCommandPayload[i];
+      pendingCommandReady = false;
+    }
+    DEBUG_PRINT(F("Received command from I2C master: "));
+    DEBUG_PRINTLN(cmd);
+    processCommand(cmd, payload);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      registerMap.flags &= ~FLAG_COMMAND_BUSY;
+    }
+  }
+}
+#endif
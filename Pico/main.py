@@ -2,8 +2,10 @@ import network
 import time
 import ubinascii
 import machine
-from machine import UART
+from machine import UART, I2C, Pin
 import gc
+import json
+import os
 
 # Try to import MQTT, handle if not available
 try:
@@ -21,6 +23,16 @@ password = 'NETWORK_PASSWORD_HERE' # Replace with your WiFi password
 mqtt_server = '0.0.0.0'  # Replace with PC's local IP
 mqtt_port = 1883
 
+# Fast reconnect: the AP (BSSID/channel) and IP lease of the last good association are cached on flash
+wifi_cache_file = 'wifi_cache.json'
+wifi_reuse_ip_lease = True    # Skip DHCP with the cached lease - disable if the DHCP server may hand the address to someone else
+wifi_fast_timeout = 5000      # Fall back to a full scan + DHCP if the cached AP does not answer within 5 seconds
+wifi_full_timeout = 20000
+mqtt_retry_interval = 2000
+mqtt_connect_timeout = 3      # Seconds - bounds the blocking connect when the broker host does not answer
+mqtt_outbox_size = 64         # Node events kept while the gateway is offline, oldest dropped first
+
+# Stable client ID - required for the broker to resume the persistent session
 client_id = ubinascii.hexlify(machine.unique_id())
 topic_pub = b'home/arduino/events'
 topic_sub = b'home/arduino/command'
@@ -28,6 +40,12 @@ topic_sub = b'home/arduino/command'
 topic_auth_request = b'home/arduino/auth_requests'
 topic_auth_response = b'home/arduino/auth_response'
 
+# Decoded node state, published retained as <prefix><node>/<field> (e.g. home/arduino/state/uart/motion)
+topic_state_prefix = b'home/arduino/state/'
+# Retained gateway liveness - the broker publishes OFFLINE (our last will) when the connection dies uncleanly,
+# so subscribers know the retained node state above is stale
+topic_gateway_state = topic_state_prefix + b'gateway'
+
 # Message codes from Arduino
 MSG_STATUS_READY = 1
 MSG_MOTION_DETECTED = 2
@@ -41,6 +59,38 @@ MSG_RFID_WRITE_FAILED = 9
 MSG_RFID_WRITE_COMPLETED = 10
 MSG_STATUS_UPDATE = 11       # General status update
 MSG_HEARTBEAT = 12          # Periodic heartbeat from Arduino
+MSG_POWER_FAIL = 13         # Arduino supply dropped below the warning threshold (sent on recovery)
+MSG_BULK_ACK = 14           # Bulk transfer reply: "ACK:offset", "DONE:target" or "ERR_<reason>:value"
+MSG_RFID_RATE_LIMITED = 15  # Card locked out by the Arduino tap rate limiter: "seconds,uid"
+MSG_INTRUSION_CONFIRMED = 16 # An Arduino correlation rule matched: "rule,deltaMs"
+MSG_EVENT_AGGREGATE = 17    # Events counted by an aggregating Arduino filter slot: "slot,count"
+MSG_ANOMALY_ALERT = 18      # An Arduino counter rate reached its threshold: "tracker,rate,threshold"
+
+# Node transport: "UART" for the byte-code stream, "I2C" to poll Arduino nodes
+# running with NODE_TRANSPORT_I2C as register-map slaves (several nodes can share the bus)
+node_transport = "UART"
+i2c_node_addresses = [0x42]
+i2c_poll_interval = 20  # Poll every node every 20ms
+i2c_command_queue_size = 8  # Commands waiting per node for its command register to free up
+
+# Arduino I2C register map (see RegisterAddress in Arduino/src/main.cpp)
+REG_ID = 0x00
+REG_FLAGS = 0x01
+REG_MOTION_AGE = 0x02
+REG_LED_RED = 0x06
+REG_BUZZER = 0x09
+REG_COUNTERS = 0x0A
+REG_EVENT_COUNT = 0x14
+REG_EVENTS = 0x15
+REG_PAYLOAD_LENGTH = 0x1D
+REG_EVENT_ACK = 0x2E
+REG_COMMAND = 0x2F
+I2C_SNAPSHOT_LENGTH = 29      # REG_ID..end of REG_EVENTS in one burst
+I2C_PAYLOAD_READ_LENGTH = 17  # Length byte + 16 byte payload mailbox
+I2C_EVENT_HAS_PAYLOAD = 0x80
+FLAG_MOTION = 0x01
+FLAG_COMMAND_BUSY = 0x20       # Node has not handled the last REG_COMMAND write yet
+FLAG_EVENT_OVERFLOW = 0x80     # Node dropped events (FIFO and held events full)
 
 # Commands to Arduino
 CMD_SET_LED_RGB = 20          # Takes RGB data: "r,g,b" or "RRGGBB"
@@ -51,6 +101,18 @@ CMD_RFID_WRITE_CONFIRM = 24   # Confirm and activate RFID write mode
 CMD_RFID_NORMAL_MODE = 25
 CMD_ACK = 26
 CMD_REQUEST_STATUS = 27       # Request status update
+CMD_SET_RFID_DUTY = 28        # Takes reader duty data: "window,period,mode" (mode 0=always on, 1=antenna off, 2=soft power-down)
+CMD_BULK_BEGIN = 29           # Takes "target,length,crc" - starts a bulk transfer
+CMD_BULK_DATA = 30            # Binary chunk frame: offset (u16 LE), length (u8), data, CRC-16 (LE)
+CMD_SET_FILTER = 31           # Takes "slot,code,zone,reader,action" (0 = any; action 0=forward, 1=suppress, 2=aggregate, 255=clear)
+CMD_SET_ANOMALY = 32          # Takes "tracker,threshold" (tracker 0=RFID failure %, 1=PIR edges/min, 2=node link errors/min; 0 disables)
+
+# Bulk transfer targets and framing (must match the Arduino)
+BULK_TARGET_CONFIG = 1
+BULK_TARGET_ALLOWLIST = 2
+BULK_TARGET_RULES = 3         # Up to 8 packed 5 byte rules: first input, second input, window ms (u16 LE), flags
+BULK_CHUNK_SIZE = 24
+BULK_WINDOW_CHUNKS = 2        # Frames per window - one window must fit the Arduino's 64 byte RX buffer
 
 # Predefined LED colors
 LED_OFF = (0, 0, 0)
@@ -77,7 +139,9 @@ motion_start_time = 0
 alarm_disabled_time = 0
 alarm_disable_duration = 60000  # 60 seconds in milliseconds
 motion_grace_period = 5000      # 5 seconds in milliseconds
-current_rfid_secret = None
+current_rfid_secret = None    # Card tap waiting for the auth server, None when no tap is pending
+auth_request_time = 0
+auth_response_timeout = 10000  # Answers arriving later than 10 seconds after the tap are ignored
 authenticated_keys = set()
 
 # Alarm control variables
@@ -99,12 +163,116 @@ led_blink_interval = 200  # 200ms for each on/off phase
 led_blink_is_on = False
 led_blink_color = LED_OFF  # Current blink color
 
+# Per-node state mirrored to the retained state topics
+UART_NODE = "uart"
+STATUS_STATE_FIELDS = ("MOTION", "RFDUTY", "RFTAP")  # TIME, RFON and RFWAKE change with every status frame
+COUNTER_STATE_FIELDS = ("motion_events", "rfid_reads", "rfid_failures", None, "link_errors")  # NodeCounters order, heartbeats skipped
+node_states = {}              # node -> {field: value}
+node_state_dirty = set()      # (node, field) pairs not yet published
+
+# Fleet correlation - cross-node rules evaluated on the gateway over events from all nodes
+node_zones = {UART_NODE: "A"}  # node -> zone, nodes without a zone are not correlated (I2C nodes are "i2c<addr>")
+fleet_rules = [
+    # (name, first zone, first event, second zone, second event, window ms) - the second event has to follow the first
+    ("A_THEN_B", "A", "MOTION", "B", "MOTION", 10000),
+]
+FLEET_EVENT_KINDS = {
+    MSG_MOTION_DETECTED: "MOTION",
+    MSG_RFID_READ_FAILED: "RFID_FAIL",
+    MSG_RFID_RATE_LIMITED: "RATE_LIMIT",
+    MSG_INTRUSION_CONFIRMED: "INTRUSION",
+}
+fleet_window_capacity = 256   # Events kept in the sliding window, oldest dropped first when full
+fleet_window = 0              # Longest rule window - events older than this leave the window
+fleet_events = [None] * fleet_window_capacity  # Ring of (time, node, zone, kind) in arrival order
+fleet_event_head = 0
+fleet_event_count = 0
+fleet_last_seen = {}          # (zone, kind) -> (time, node) of the newest matching event in the window
+fleet_rules_by_second = {}    # (zone, kind) -> rules that event can complete
+fleet_rule_fired = {}         # rule name -> time of the first event already reported
+
+# Bulk transfer state (asynchronous, driven from the main loop)
+bulk_upload = None            # dict with target, blob, acked offset and retry state while a transfer runs
+bulk_ack_timeout = 1000       # Resend the window if no reply arrives within 1 second
+bulk_max_retries = 5
+bulk_held_commands = []       # UART commands held back during a transfer - the node treats them as line noise
+
 # Pico heartbeat for client communication
 last_pico_heartbeat = 0
 pico_heartbeat_interval = 15000  # Send heartbeat every 15 seconds
 
+def load_wifi_cache():
+    """Load the cached AP and IP lease, None if there is none"""
+    try:
+        with open(wifi_cache_file) as f:
+            return json.load(f)
+    except (OSError, ValueError):
+        return None
+
+def save_wifi_cache(wlan, scan=True):
+    """Cache the BSSID/channel of the strongest AP for our SSID and the current IP lease
+    
+    Scanning blocks for seconds, so the background reconnect passes scan=False and takes the
+    AP from the driver instead - if the driver does not report it, the next boot caches it.
+    """
+    try:
+        if scan:
+            best = None
+            for net in wlan.scan():
+                if net[0].decode() == ssid and (best is None or net[3] > best[3]):
+                    best = net
+            if best is None:
+                return
+            bssid, channel = best[1], best[2]
+        else:
+            try:
+                bssid, channel = wlan.config('bssid'), wlan.config('channel')
+            except (ValueError, OSError):
+                print("WiFi driver does not report the BSSID - cache left for the next boot")
+                return
+        cache = {
+            'bssid': ubinascii.hexlify(bssid).decode(),
+            'channel': channel,
+            'ifconfig': list(wlan.ifconfig()),
+        }
+        with open(wifi_cache_file, 'w') as f:
+            json.dump(cache, f)
+        print(f"WiFi cache saved: BSSID {cache['bssid']} channel {cache['channel']}")
+    except Exception as e:
+        print(f"Failed to save WiFi cache: {e}")
+
+def clear_wifi_cache():
+    """Forget the cached AP and IP lease"""
+    try:
+        os.remove(wifi_cache_file)
+    except OSError:
+        pass
+
+def start_wifi_connect(wlan, cache):
+    """Start a (non-blocking) association - to the cached AP if there is one"""
+    if cache:
+        print(f"Fast WiFi connect to cached BSSID {cache['bssid']} (channel {cache['channel']})")
+        wlan.connect(ssid, password, bssid=ubinascii.unhexlify(cache['bssid']))
+    else:
+        print(f'Connecting to WiFi network: {ssid}')
+        wlan.ifconfig('dhcp')
+        wlan.connect(ssid, password)
+
+def poll_wifi_connect(wlan, cache):
+    """Check an association in progress: True when online, False on failure, None while pending"""
+    status = wlan.status()
+    if status == 2 and cache and wifi_reuse_ip_lease:
+        # Link is up - apply the cached lease instead of waiting for DHCP
+        wlan.ifconfig(tuple(cache['ifconfig']))
+        status = wlan.status()
+    if status == 3 or wlan.isconnected():
+        return True
+    if status < 0:
+        return False
+    return None
+
 def connect_wifi():
-    """Connect to WiFi with error handling"""
+    """Connect to WiFi with error handling, trying the cached AP and lease first"""
     wlan = network.WLAN(network.STA_IF)
     wlan.active(True)
     
@@ -112,25 +280,32 @@ def connect_wifi():
         print('Already connected to WiFi:', wlan.ifconfig())
         return wlan
     
-    print(f'Connecting to WiFi network: {ssid}')
-    wlan.connect(ssid, password)
+    cache = load_wifi_cache()
+    attempts = [(cache, wifi_fast_timeout)] if cache else []
+    attempts.append((None, wifi_full_timeout))
     
-    max_wait = 20
-    while max_wait > 0:
-        if wlan.status() < 0 or wlan.status() >= 3:
-            break
-        max_wait -= 1
-        print(f'Waiting for connection... ({max_wait})')
-        time.sleep(1)
-    
-    if wlan.status() != 3:
-        print(f'WiFi connection failed. Status: {wlan.status()}')
-        return None
-    else:
-        print('WiFi connected successfully!')
-        status = wlan.ifconfig()
-        print(f'IP: {status[0]}')
-        return wlan
+    for attempt_cache, timeout in attempts:
+        if attempt_cache is None and cache is not None:
+            print("Cached WiFi association failed - falling back to full connect")
+            wlan.disconnect()
+            clear_wifi_cache()
+        
+        start_wifi_connect(wlan, attempt_cache)
+        start = time.ticks_ms()
+        result = None
+        while result is None and time.ticks_diff(time.ticks_ms(), start) < timeout:
+            time.sleep_ms(50)
+            result = poll_wifi_connect(wlan, attempt_cache)
+        
+        if result:
+            print(f'WiFi connected successfully in {time.ticks_diff(time.ticks_ms(), start)}ms!')
+            print(f'IP: {wlan.ifconfig()[0]}')
+            if attempt_cache is None:
+                save_wifi_cache(wlan)
+            return wlan
+    
+    print(f'WiFi connection failed. Status: {wlan.status()}')
+    return None
 
 # MQTT Callback - Handle commands from server
 def sub_cb(topic, msg):
@@ -171,6 +346,30 @@ def sub_cb(topic, msg):
             abort_operation()
         elif msg_str == "CMD_RFID_WRITE_INITALIZE":
             initialize_rfid_write()
+        elif msg_str.startswith("CMD_BULK_UPLOAD:"):
+            # Format: "CMD_BULK_UPLOAD:<target>:<hex data>"
+            target, hex_data = msg_str[16:].split(':', 1)
+            start_bulk_upload(int(target), ubinascii.unhexlify(hex_data))
+        elif msg_str.startswith("CMD_SET_FILTER:"):
+            filter_data = msg_str[15:]  # Extract data after "CMD_SET_FILTER:"
+            send_uart_command_with_data(CMD_SET_FILTER, filter_data)
+            safe_mqtt_publish(topic_pub, "ACK_CMD_SET_FILTER")
+        elif msg_str.startswith("CMD_SET_RFID_DUTY:"):
+            duty_data = msg_str[18:]  # Extract data after "CMD_SET_RFID_DUTY:"
+            send_uart_command_with_data(CMD_SET_RFID_DUTY, duty_data)
+            safe_mqtt_publish(topic_pub, "ACK_CMD_SET_RFID_DUTY")
+        elif msg_str.startswith("CMD_SET_ANOMALY:"):
+            anomaly_data = msg_str[16:]  # Extract data after "CMD_SET_ANOMALY:"
+            send_uart_command_with_data(CMD_SET_ANOMALY, anomaly_data)
+            safe_mqtt_publish(topic_pub, "ACK_CMD_SET_ANOMALY")
+        elif msg_str.startswith("CMD_SET_FLEET_RULE:"):
+            # Format: "CMD_SET_FLEET_RULE:name,firstZone,firstEvent,secondZone,secondEvent,windowMs"
+            if set_fleet_rule(msg_str[19:]):
+                safe_mqtt_publish(topic_pub, "ACK_CMD_SET_FLEET_RULE")
+        elif msg_str.startswith("CMD_SET_NODE_ZONE:"):
+            # Format: "CMD_SET_NODE_ZONE:node,zone"
+            set_node_zone(msg_str[18:])
+            safe_mqtt_publish(topic_pub, "ACK_CMD_SET_NODE_ZONE")
             
     except Exception as e:
         print("Error processing MQTT message:", e)
@@ -190,14 +389,19 @@ def connect_mqtt():
         
         client = MQTTClient(client_id, mqtt_server, port=mqtt_port, keepalive=60)
         client.set_callback(sub_cb)
+        client.set_last_will(topic_gateway_state, b'OFFLINE', retain=True)
         
         print(f'Connecting to MQTT broker at {mqtt_server}:{mqtt_port}')
-        client.connect()
-        
-        client.subscribe(topic_sub)
-        client.subscribe(topic_auth_response)
+        # Persistent session - the broker keeps our subscriptions and queues QoS 1 commands while we are away
+        session_present = client.connect(clean_session=False, timeout=mqtt_connect_timeout)
         
-        print('MQTT Connected & Subscribed successfully!')
+        if session_present:
+            print('MQTT session resumed - subscriptions kept by broker')
+        else:
+            client.subscribe(topic_sub, qos=1)
+            print('MQTT Connected & Subscribed successfully!')
+        # QoS 0 (renewed on resume too) - the broker must not queue auth answers for a tap the user has walked away from
+        client.subscribe(topic_auth_response, qos=0)
         return client
         
     except OSError as e:
@@ -208,18 +412,35 @@ def connect_mqtt():
         print(f'Unexpected MQTT error: {e}')
         return None
 
+# Gateway link state - node frames keep being processed (and buffered) while offline
+boot_time = time.ticks_ms()
+link_online = False
+link_lost_time = boot_time
+link_lost_reason = "BOOT"
+wifi_connecting = False
+wifi_connect_start = 0
+wifi_connect_cache = None
+last_mqtt_attempt = 0
+mqtt_outbox = []
+mqtt_outbox_dropped = 0
+
 # Connect to WiFi
 wlan = connect_wifi()
 if not wlan:
-    print("Failed to connect to WiFi - stopping")
-    raise Exception("WiFi connection failed")
+    print("Failed to connect to WiFi - retrying in the background")
+    wlan = network.WLAN(network.STA_IF)
 
 # Connect to MQTT
-client = connect_mqtt()
+client = connect_mqtt() if wlan.isconnected() else None
 
 # UART to Arduino
 uart = UART(0, baudrate=9600, tx=0, rx=1)  # GP0=TX, GP1=RX
 
+# I2C bus to Arduino nodes (only used when node_transport == "I2C")
+i2c = I2C(0, sda=Pin(4), scl=Pin(5), freq=100000) if node_transport == "I2C" else None  # GP4=SDA, GP5=SCL
+last_i2c_poll = 0
+i2c_command_queues = {}  # address -> command frames waiting for the node's command register
+
 # Color constants
 LED_OFF = (0, 0, 0)
 LED_RED = (255, 0, 0)
@@ -231,23 +452,135 @@ LED_CYAN = (0, 255, 255)
 LED_WHITE = (255, 255, 255)
 LED_ORANGE = (255, 165, 0)
 
-def safe_mqtt_publish(topic, message):
-    """Safely publish MQTT message with error handling"""
-    if client is None:
-        print(f"MQTT not available - would publish: {topic}: {message}")
+def queue_mqtt_publish(topic, message):
+    """Keep a message for delivery once the gateway is back online"""
+    global mqtt_outbox_dropped
+    
+    if not MQTT_AVAILABLE or message in ("PICO_HEARTBEAT", "ARDUINO_HEARTBEAT"):
+        return  # Stale heartbeats are worthless after a reconnect
+    if topic == topic_auth_request:
+        return  # A card tap (and its ACK) is only meaningful while the user is at the reader - replayed later it could disarm an unattended system
+    if len(mqtt_outbox) >= mqtt_outbox_size:
+        mqtt_outbox.pop(0)
+        mqtt_outbox_dropped += 1
+    mqtt_outbox.append((topic, message))
+
+def safe_mqtt_publish(topic, message, retain=False):
+    """Safely publish MQTT message with error handling
+    
+    Retained state messages are not buffered - the node state flush republishes them once online.
+    """
+    if client is None or not link_online:
+        if not retain:
+            print(f"MQTT offline - buffering: {topic}: {message}")
+            queue_mqtt_publish(topic, message)
         return False
     
     try:
-        client.publish(topic, message)
+        client.publish(topic, message, retain)
         print(f"MQTT published: {topic.decode()} -> {message}")
         return True
     except Exception as e:
         print(f"MQTT publish failed: {e}")
+        if not retain:
+            queue_mqtt_publish(topic, message)
+        mark_link_lost("MQTT")
         return False
 
+def flush_mqtt_outbox():
+    """Publish the messages buffered while offline, oldest first"""
+    global mqtt_outbox_dropped
+    
+    if mqtt_outbox_dropped:
+        print(f"MQTT outbox overflowed - {mqtt_outbox_dropped} messages dropped")
+        mqtt_outbox_dropped = 0
+    while mqtt_outbox and link_online:
+        topic, message = mqtt_outbox[0]
+        try:
+            client.publish(topic, message)
+            mqtt_outbox.pop(0)
+            print(f"MQTT published (buffered): {topic.decode()} -> {message}")
+        except Exception as e:
+            print(f"MQTT publish of buffered message failed: {e}")
+            mark_link_lost("MQTT")
+
+def mark_link_lost(reason):
+    """Take the gateway offline and start reconnecting from the main loop"""
+    global link_online, link_lost_time, link_lost_reason
+    
+    if not link_online:
+        return
+    print(f"Gateway link lost ({reason}) - buffering node events")
+    link_online = False
+    link_lost_time = time.ticks_ms()
+    link_lost_reason = reason
+
+def mark_link_online():
+    """Bring the gateway online, report the time it took and flush the outbox"""
+    global link_online
+    
+    link_online = True
+    downtime = time.ticks_diff(time.ticks_ms(), link_lost_time)
+    buffered = len(mqtt_outbox)
+    print(f"Gateway online after {downtime}ms ({link_lost_reason}), {buffered} buffered messages")
+    safe_mqtt_publish(topic_gateway_state, "ONLINE", retain=True)  # Replaces the retained last will
+    safe_mqtt_publish(topic_pub, f"GATEWAY_ONLINE:{link_lost_reason},{downtime},{buffered}")
+    flush_mqtt_outbox()
+    flush_node_state()
+
+def update_gateway_link():
+    """Re-associate WiFi and resume the MQTT session without blocking the main loop"""
+    global client, wifi_connecting, wifi_connect_start, wifi_connect_cache, last_mqtt_attempt
+    
+    if not MQTT_AVAILABLE:
+        return
+    
+    if not wlan.isconnected():
+        mark_link_lost("WIFI")
+        current_time = time.ticks_ms()
+        if not wifi_connecting:
+            wifi_connect_cache = load_wifi_cache()
+            start_wifi_connect(wlan, wifi_connect_cache)
+            wifi_connecting = True
+            wifi_connect_start = current_time
+            return
+        
+        result = poll_wifi_connect(wlan, wifi_connect_cache)
+        timeout = wifi_fast_timeout if wifi_connect_cache else wifi_full_timeout
+        if result is False or (result is None and time.ticks_diff(current_time, wifi_connect_start) > timeout):
+            if wifi_connect_cache:
+                print("Cached WiFi association failed - falling back to full connect")
+                clear_wifi_cache()
+            wlan.disconnect()
+            wifi_connecting = False  # Retry on the next pass (full connect once the cache is gone)
+        if not result:
+            return
+    
+    if wifi_connecting:
+        wifi_connecting = False
+        print(f"WiFi re-associated in {time.ticks_diff(time.ticks_ms(), wifi_connect_start)}ms")
+        if wifi_connect_cache is None:
+            save_wifi_cache(wlan, scan=False)
+    
+    if link_online:
+        return
+    
+    # WiFi is up - resume the MQTT session, rate limited since connect blocks (up to mqtt_connect_timeout)
+    if time.ticks_diff(time.ticks_ms(), last_mqtt_attempt) < mqtt_retry_interval:
+        return
+    last_mqtt_attempt = time.ticks_ms()
+    if client is not None:
+        try:
+            client.sock.close()  # Drop the dead connection, the session lives on at the broker
+        except Exception:
+            pass
+    client = connect_mqtt()
+    if client is not None:
+        mark_link_online()
+
 def safe_mqtt_check():
     """Safely check MQTT messages with error handling"""
-    if client is None:
+    if client is None or not link_online:
         return
     
     try:
@@ -257,19 +590,174 @@ def safe_mqtt_check():
             pass  # This is normal, just means no MQTT messages waiting
         else:
             print(f"MQTT OSError: {e}")
+            mark_link_lost("MQTT")
     except Exception as e:
         print(f"MQTT check_msg failed: {e}")
 
 def send_uart_command(cmd):
     """Send a command code to Arduino"""
-    uart.write(bytes([cmd]))
+    if node_transport == "I2C":
+        if cmd in (CMD_SET_BUZZER_ON, CMD_SET_BUZZER_OFF):
+            # Actuator register like the LED - always applies the latest value
+            write_i2c_nodes(REG_BUZZER, bytes([cmd == CMD_SET_BUZZER_ON]))
+            return
+        queue_i2c_command(bytes([cmd]))
+        return
+    write_uart_command(cmd, bytes([cmd]))
 
 def send_uart_command_with_data(cmd, data):
     """Send a command with data to Arduino"""
-    uart.write(bytes([cmd]))
-    uart.write(b':')
-    uart.write(data.encode('utf-8'))
-    uart.write(b'\n')
+    if node_transport == "I2C":
+        queue_i2c_command(bytes([cmd]) + data.encode('utf-8'))
+        return
+    write_uart_command(cmd, bytes([cmd]) + b':' + data.encode('utf-8') + b'\n')
+
+def write_uart_command(cmd, frame):
+    """Write a command frame, or hold it until the running bulk transfer ends"""
+    if bulk_upload is not None and cmd != CMD_BULK_BEGIN:
+        bulk_held_commands.append(frame)
+        return
+    uart.write(frame)
+
+def write_i2c_node(address, register, data):
+    """Write data starting at a register on one I2C node"""
+    try:
+        i2c.writeto_mem(address, register, data)
+        return True
+    except OSError as e:
+        print(f"I2C write to node 0x{address:02x} failed: {e}")
+        return False
+
+def write_i2c_nodes(register, data):
+    """Write data starting at a register on every I2C node"""
+    for address in i2c_node_addresses:
+        write_i2c_node(address, register, data)
+
+def queue_i2c_command(frame):
+    """Queue a command for every I2C node - a node takes one at a time, see send_i2c_command()"""
+    for address in i2c_node_addresses:
+        queue = i2c_command_queues.setdefault(address, [])
+        if len(queue) >= i2c_command_queue_size:
+            print(f"I2C command queue of node 0x{address:02x} full - dropping oldest command")
+            queue.pop(0)
+        queue.append(frame)
+
+def send_i2c_command(address, flags):
+    """Write the next queued command once the node has handled the previous one"""
+    queue = i2c_command_queues.get(address)
+    if not queue or flags & FLAG_COMMAND_BUSY:
+        return
+    if write_i2c_node(address, REG_COMMAND, queue[0]):
+        queue.pop(0)
+
+def crc16_ccitt(data, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE, matches crc16Update() on the Arduino"""
+    for byte_val in data:
+        crc ^= byte_val << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+def start_bulk_upload(target, blob):
+    """Start streaming a blob into an Arduino EEPROM region
+    
+    Args:
+        target: Bulk target (e.g. BULK_TARGET_CONFIG)
+        blob: bytes to transfer
+    """
+    global bulk_upload
+    
+    if node_transport != "UART":
+        print("Bulk transfer requires the UART transport")
+        safe_mqtt_publish(topic_pub, "BULK_FAILED:TRANSPORT")
+        return
+    if bulk_upload is not None:
+        print("Bulk transfer already in progress")
+        safe_mqtt_publish(topic_pub, "BULK_FAILED:BUSY")
+        return
+    
+    print(f"Starting bulk transfer of {len(blob)} bytes to target {target}")
+    bulk_upload = {
+        'target': target,
+        'blob': blob,
+        'acked': 0,
+        'started': False,      # Set once the Arduino accepted CMD_BULK_BEGIN
+        'awaiting': True,
+        'last_send': time.ticks_ms(),
+        'retries': 0,
+        'start_time': time.ticks_ms(),
+    }
+    send_uart_command_with_data(CMD_BULK_BEGIN, f"{target},{len(blob)},{crc16_ccitt(blob)}")
+
+def send_bulk_window():
+    """Send up to BULK_WINDOW_CHUNKS frames starting at the last acknowledged offset"""
+    blob = bulk_upload['blob']
+    offset = bulk_upload['acked']
+    for _ in range(BULK_WINDOW_CHUNKS):
+        if offset >= len(blob):
+            break
+        chunk = blob[offset:offset + BULK_CHUNK_SIZE]
+        header = bytes([offset & 0xFF, offset >> 8, len(chunk)])
+        crc = crc16_ccitt(chunk, crc16_ccitt(header))
+        uart.write(bytes([CMD_BULK_DATA]) + header + chunk + bytes([crc & 0xFF, crc >> 8]))
+        offset += len(chunk)
+    bulk_upload['awaiting'] = True
+    bulk_upload['last_send'] = time.ticks_ms()
+
+def finish_bulk_upload(result):
+    """End the current bulk transfer and report the result"""
+    global bulk_upload
+    
+    elapsed = time.ticks_diff(time.ticks_ms(), bulk_upload['start_time'])
+    print(f"Bulk transfer to target {bulk_upload['target']} finished: {result} ({elapsed}ms)")
+    safe_mqtt_publish(topic_pub, f"BULK_{result}:{bulk_upload['target']}")
+    bulk_upload = None
+    while bulk_held_commands:
+        uart.write(bulk_held_commands.pop(0))
+
+def handle_bulk_reply(data):
+    """Handle a MSG_BULK_ACK reply from Arduino"""
+    if bulk_upload is None:
+        print(f"Unexpected bulk reply: {data}")
+        return
+    
+    status, _, value = data.partition(':')
+    if status == "ACK":
+        offset = int(value)
+        if offset > bulk_upload['acked'] or not bulk_upload['started']:
+            bulk_upload['retries'] = 0  # Progress made
+        else:
+            bulk_upload['retries'] += 1
+        bulk_upload['acked'] = offset
+        bulk_upload['started'] = True
+        bulk_upload['awaiting'] = False
+    elif status == "DONE":
+        finish_bulk_upload("DONE")
+    else:
+        finish_bulk_upload(f"FAILED:{status}")
+
+def update_bulk_upload():
+    """Drive the bulk transfer window - call this in main loop"""
+    if bulk_upload is None:
+        return
+    
+    if bulk_upload['retries'] > bulk_max_retries:
+        finish_bulk_upload("FAILED:RETRIES")
+        return
+    
+    if bulk_upload['awaiting']:
+        if time.ticks_diff(time.ticks_ms(), bulk_upload['last_send']) < bulk_ack_timeout:
+            return
+        # No reply - resend the window (or the begin command) from the last acknowledged offset
+        bulk_upload['retries'] += 1
+        if not bulk_upload['started']:
+            blob = bulk_upload['blob']
+            send_uart_command_with_data(CMD_BULK_BEGIN, f"{bulk_upload['target']},{len(blob)},{crc16_ccitt(blob)}")
+            bulk_upload['last_send'] = time.ticks_ms()
+            return
+    
+    send_bulk_window()
 
 def set_led_color(color):
     """Set LED color - flexible function that accepts:
@@ -294,6 +782,10 @@ def set_led_color(color):
         green = max(0, min(255, int(green)))
         blue = max(0, min(255, int(blue)))
         rgb_data = f"{red},{green},{blue}"
+        if node_transport == "I2C":
+            # Write the actuator registers directly
+            write_i2c_nodes(REG_LED_RED, bytes([red, green, blue]))
+            return
     elif isinstance(color, str):
         # String format: "r,g,b" or "RRGGBB"
         rgb_data = color
@@ -431,21 +923,53 @@ def activate_alarm():
     safe_mqtt_publish(topic_pub, "ALARM_TRIGGERED")
     print("ALARM ACTIVATED - Motion detected for more than 5 seconds")
 
+def handle_intrusion_confirmed(data):
+    """Handle an intrusion confirmed by an Arduino correlation rule - skips the motion grace period"""
+    print(f"Intrusion confirmed by Arduino rule: {data}")
+    safe_mqtt_publish(topic_pub, f"INTRUSION_CONFIRMED:{data}")
+    
+    if current_state in (SecurityState.READY, SecurityState.MOTION_DETECTED):
+        activate_alarm()
+
+def handle_fleet_alarm(data):
+    """Handle an alarm derived by a fleet rule across nodes - data is "rule,firstNode,secondNode,deltaMs" """
+    print(f"Fleet rule matched: {data}")
+    safe_mqtt_publish(topic_pub, f"FLEET_ALARM:{data}")
+    
+    if current_state in (SecurityState.READY, SecurityState.MOTION_DETECTED):
+        activate_alarm()
+
 def handle_rfid_detected(secret_key):
     """Handle RFID card detection"""
-    global current_rfid_secret
+    global current_rfid_secret, auth_request_time
     
     current_rfid_secret = secret_key
+    auth_request_time = time.ticks_ms()
     
     # Send authentication request to server
     auth_request = f"AUTH_REQUEST:{secret_key}"
     safe_mqtt_publish(topic_auth_request, auth_request)
     print(f"RFID authentication request sent: {secret_key}")
 
+def take_pending_auth(response):
+    """Claim the pending card tap for an auth response - False (and ACK to stop retries) if there is none or it is stale"""
+    global current_rfid_secret
+    
+    pending = current_rfid_secret is not None and \
+        time.ticks_diff(time.ticks_ms(), auth_request_time) <= auth_response_timeout
+    current_rfid_secret = None
+    if not pending:
+        print(f"Ignoring {response} - no card tap pending")
+        safe_mqtt_publish(topic_auth_request, f"ACK_{response}")
+    return pending
+
 def handle_auth_success():
     """Handle successful authentication"""
     global current_state, alarm_disabled_time
     
+    if not take_pending_auth("AUTH_SUCCESS"):
+        return
+    
     # RFID cannot disable manually activated alarms
     if manually_activated and current_state == SecurityState.ALARM_ACTIVE:
         print("Authentication successful but alarm is manually activated - RFID disable blocked")
@@ -466,6 +990,9 @@ def handle_auth_success():
 
 def handle_auth_failed():
     """Handle failed authentication"""
+    if not take_pending_auth("AUTH_FAILED"):
+        return
+    
     print("Authentication failed")
     
     # Start asynchronous red LED blinking (3 times) to indicate authentication failure
@@ -669,6 +1196,8 @@ def check_arduino_connection():
             arduino_connected = False
             print("Arduino connection lost - no heartbeat")
             safe_mqtt_publish(topic_pub, "ARDUINO_DISCONNECTED")
+            if node_transport == "UART":
+                update_node_state(UART_NODE, {"link": "OFFLINE"})  # I2C nodes report their own link state from the poll
 
 def send_pico_heartbeat():
     """Send periodic heartbeat from Pico to indicate it's alive"""
@@ -694,17 +1223,155 @@ def test_mqtt_publishing():
             print(f"✗ Failed to send {msg}")
         time.sleep(1)  # Wait 1 second between messages
 
-def process_arduino_message(msg_code):
+def update_node_state(node, fields):
+    """Merge decoded fields into the state of a node and publish the ones that changed"""
+    state = node_states.setdefault(node, {})
+    for field, value in fields.items():
+        if state.get(field) != value:
+            state[field] = value
+            node_state_dirty.add((node, field))
+    
+    flush_node_state()
+
+def flush_node_state():
+    """Publish changed node state fields as retained messages so new subscribers get the fleet state at once"""
+    while node_state_dirty and link_online:
+        node, field = node_state_dirty.pop()
+        topic = topic_state_prefix + f"{node}/{field}".encode()
+        if not safe_mqtt_publish(topic, node_states[node][field], retain=True):
+            node_state_dirty.add((node, field))  # Retry after the reconnect
+            break
+
+def index_fleet_rules():
+    """Index the fleet rules by their second event so each event only checks the rules it can complete"""
+    global fleet_window
+    
+    fleet_rules_by_second.clear()
+    fleet_window = 0
+    for rule in fleet_rules:
+        fleet_rules_by_second.setdefault((rule[3], rule[4]), []).append(rule)
+        fleet_window = max(fleet_window, rule[5])
+
+def set_fleet_rule(rule_data):
+    """Add or replace a fleet rule from "name,firstZone,firstEvent,secondZone,secondEvent,windowMs" - a bare name removes it"""
+    global fleet_rules
+    
+    fields = [field.strip() for field in rule_data.split(',')]
+    # Validate before touching the rule set - a bad command must leave the existing rule in place
+    rule = None
+    if len(fields) == 6:
+        try:
+            window = int(fields[5])
+        except ValueError:
+            window = 0
+        if window > 0:
+            rule = (fields[0], fields[1], fields[2], fields[3], fields[4], window)
+    if rule is None and len(fields) != 1:
+        print(f"Invalid fleet rule: {rule_data}")
+        return False
+    
+    fleet_rules = [existing for existing in fleet_rules if existing[0] != fields[0]]
+    if rule:
+        fleet_rules.append(rule)
+    fleet_rule_fired.pop(fields[0], None)
+    index_fleet_rules()
+    print(f"Fleet rules: {fleet_rules}")
+    return True
+
+def set_node_zone(zone_data):
+    """Assign a node to a zone from "node,zone" - an empty zone stops correlating the node"""
+    node, zone = [field.strip() for field in zone_data.split(',', 1)]
+    if zone:
+        node_zones[node] = zone
+    else:
+        node_zones.pop(node, None)
+    print(f"Node zones: {node_zones}")
+
+def expire_fleet_events(now):
+    """Drop events that left the sliding window, together with their last-seen entries"""
+    global fleet_event_head, fleet_event_count
+    
+    while fleet_event_count:
+        event_time, node, zone, kind = fleet_events[fleet_event_head]
+        if time.ticks_diff(now, event_time) <= fleet_window:
+            if fleet_event_count < fleet_window_capacity:
+                break
+            print("Fleet window full - dropping oldest event")
+        if fleet_last_seen.get((zone, kind), (None,))[0] == event_time:
+            del fleet_last_seen[(zone, kind)]
+        fleet_events[fleet_event_head] = None
+        fleet_event_head = (fleet_event_head + 1) % fleet_window_capacity
+        fleet_event_count -= 1
+
+def note_fleet_event(node, kind):
+    """Add a node event to the fleet window and fire the rules it completes
+    
+    Events are stamped on arrival at the gateway. Only rules whose second event matches are checked,
+    each against the last-seen map, so the cost stays constant per event however many nodes report.
+    """
+    global fleet_event_count
+    
+    zone = node_zones.get(node)
+    if zone is None:
+        return
+    now = time.ticks_ms()
+    
+    expire_fleet_events(now)
+    fleet_events[(fleet_event_head + fleet_event_count) % fleet_window_capacity] = (now, node, zone, kind)
+    fleet_event_count += 1
+    
+    for name, first_zone, first_kind, _, _, window in fleet_rules_by_second.get((zone, kind), ()):
+        first = fleet_last_seen.get((first_zone, first_kind))
+        if first is None or fleet_rule_fired.get(name) == first[0]:
+            continue  # No first event in the window, or already reported for it
+        delta = time.ticks_diff(now, first[0])
+        if delta > window:
+            continue
+        fleet_rule_fired[name] = first[0]
+        handle_fleet_alarm(f"{name},{first[1]},{node},{delta}")
+    
+    # Recorded after the rule check so "zone A then zone A" rules pair with the previous event
+    fleet_last_seen[(zone, kind)] = (now, node)
+
+def decode_status_fields(data):
+    """Pick the state fields out of a "MOTION:ACTIVE,TIME:1234,..." status frame"""
+    fields = {}
+    for part in data.split(','):
+        key_value = part.split(':', 1)
+        if len(key_value) == 2 and key_value[0].strip() in STATUS_STATE_FIELDS:
+            fields[key_value[0].strip().lower()] = key_value[1].strip()
+    return fields
+
+def decode_snapshot_fields(snapshot):
+    """Decode the state fields of an I2C register snapshot"""
+    red, green, blue = snapshot[REG_LED_RED:REG_LED_RED + 3]
+    fields = {
+        "motion": "ACTIVE" if snapshot[REG_FLAGS] & FLAG_MOTION else "INACTIVE",
+        "led": f"{red:02X}{green:02X}{blue:02X}",
+        "buzzer": "ON" if snapshot[REG_BUZZER] else "OFF",
+    }
+    for index, field in enumerate(COUNTER_STATE_FIELDS):
+        if field:
+            offset = REG_COUNTERS + index * 2
+            fields[field] = str(int.from_bytes(snapshot[offset:offset + 2], 'little'))
+    return fields
+
+def process_arduino_message(msg_code, node=UART_NODE):
     """Process message codes from Arduino"""
+    update_node_state(node, {"link": "ONLINE"})
+    if msg_code in FLEET_EVENT_KINDS:
+        note_fleet_event(node, FLEET_EVENT_KINDS[msg_code])
     
     if msg_code == MSG_STATUS_READY:
         print("Arduino ready")
         safe_mqtt_publish(topic_pub, "STATUS_READY")
         
     elif msg_code == MSG_MOTION_DETECTED:
+        update_node_state(node, {"motion": "ACTIVE"})
         handle_motion_detected()
         
     elif msg_code == MSG_MOTION_STOPPED:
+        update_node_state(node, {"motion": "INACTIVE"})
         handle_motion_stopped()
         
     elif msg_code == MSG_RFID_DETECTED:
@@ -736,6 +1403,94 @@ def process_arduino_message(msg_code):
     else:
         print(f"Unknown message code from Arduino: {msg_code}")
 
+def process_arduino_data_message(msg_code, data, node=UART_NODE):
+    """Process message codes from Arduino that carry data"""
+    update_node_state(node, {"link": "ONLINE"})
+    if msg_code in FLEET_EVENT_KINDS:
+        note_fleet_event(node, FLEET_EVENT_KINDS[msg_code])
+    
+    if msg_code == MSG_RFID_READ_SUCCESS:
+        handle_rfid_detected(data)
+    elif msg_code == MSG_RFID_READ_FAILED:
+        print("RFID read failed")
+        safe_mqtt_publish(topic_pub, "RFID_READ_FAILED")
+    elif msg_code == MSG_STATUS_UPDATE:
+        print(f"Arduino status update: {data}")
+        safe_mqtt_publish(topic_pub, f"ARDUINO_STATUS:{data}")
+        update_node_state(node, decode_status_fields(data))
+    elif msg_code == MSG_HEARTBEAT:
+        handle_arduino_heartbeat()
+    elif msg_code == MSG_BULK_ACK:
+        handle_bulk_reply(data)
+    elif msg_code == MSG_EVENT_AGGREGATE:
+        print(f"Arduino aggregated events: {data}")
+        safe_mqtt_publish(topic_pub, f"EVENT_AGGREGATE:{data}")
+    elif msg_code == MSG_INTRUSION_CONFIRMED:
+        handle_intrusion_confirmed(data)
+    elif msg_code == MSG_RFID_RATE_LIMITED:
+        print(f"RFID card rate limited: {data}")
+        safe_mqtt_publish(topic_pub, f"RFID_RATE_LIMITED:{data}")
+    elif msg_code == MSG_POWER_FAIL:
+        print(f"Arduino recovered from power fail: {data}")
+        safe_mqtt_publish(topic_pub, f"ARDUINO_POWER_FAIL:{data}")
+    elif msg_code == MSG_ANOMALY_ALERT:
+        print(f"Arduino counter anomaly on {node}: {data}")
+        safe_mqtt_publish(topic_pub, f"ANOMALY_ALERT:{node},{data}")
+    else:
+        print(f"Unknown message code with data: {msg_code}")
+
+def poll_i2c_node(address):
+    """Fetch the snapshot and event FIFO of one I2C node in a single burst and dispatch its events"""
+    node = f"i2c{address:02x}"
+    try:
+        snapshot = i2c.readfrom_mem(address, REG_ID, I2C_SNAPSHOT_LENGTH)
+        event_count = snapshot[REG_EVENT_COUNT]
+        events = snapshot[REG_EVENTS:REG_EVENTS + event_count]
+        
+        payload = None
+        if any(code & I2C_EVENT_HAS_PAYLOAD for code in events):
+            mailbox = i2c.readfrom_mem(address, REG_PAYLOAD_LENGTH, I2C_PAYLOAD_READ_LENGTH)
+            payload = mailbox[1:1 + mailbox[0]]
+    except OSError as e:
+        print(f"I2C poll of node 0x{address:02x} failed: {e}")
+        update_node_state(node, {"link": "OFFLINE"})
+        return
+    
+    if payload is not None:
+        try:
+            payload = payload.decode('utf-8')
+        except UnicodeError:
+            print(f"I2C node 0x{address:02x} sent an invalid payload: {payload} - dropping its event")
+            payload = None
+    
+    update_node_state(node, {"link": "ONLINE"})
+    update_node_state(node, decode_snapshot_fields(snapshot))
+    
+    if snapshot[REG_FLAGS] & FLAG_EVENT_OVERFLOW:
+        print(f"I2C node 0x{address:02x} dropped events - FIFO and held events full")
+    
+    for code in events:
+        if code & I2C_EVENT_HAS_PAYLOAD:
+            if payload is None:
+                continue
+            process_arduino_data_message(code & ~I2C_EVENT_HAS_PAYLOAD, payload, node)
+        elif code == MSG_STATUS_UPDATE:
+            # Status fields live in the snapshot registers rather than in a payload
+            motion_age = int.from_bytes(snapshot[REG_MOTION_AGE:REG_MOTION_AGE + 4], 'little')
+            motion = "ACTIVE" if snapshot[REG_FLAGS] & FLAG_MOTION else "INACTIVE"
+            process_arduino_data_message(code, f"MOTION:{motion},TIME:{motion_age}", node)
+        else:
+            process_arduino_message(code, node)
+    
+    if event_count:
+        write_i2c_node(address, REG_EVENT_ACK, bytes([event_count]))
+    send_i2c_command(address, snapshot[REG_FLAGS])
+
+def poll_i2c_nodes():
+    """Poll all configured I2C nodes"""
+    for address in i2c_node_addresses:
+        poll_i2c_node(address)
+
 # Buffer for UART data
 uart_buffer = b''
 
@@ -743,8 +1498,14 @@ uart_buffer = b''
 last_mqtt_check = time.ticks_ms()
 mqtt_check_interval = 30000  # Check MQTT connection every 30 seconds
 
+index_fleet_rules()
+
 print("Security system initialized")
 
+# Report time-to-online after power-up (or keep buffering until the link comes up)
+if client is not None:
+    mark_link_online()
+
 # Send initial status to indicate Pico is ready
 safe_mqtt_publish(topic_pub, "PICO_READY")
 
@@ -758,14 +1519,16 @@ while True:
         last_pico_heartbeat = current_time
     
     # Periodic MQTT connection check
-    if client and time.ticks_diff(current_time, last_mqtt_check) > mqtt_check_interval:
+    if client and link_online and time.ticks_diff(current_time, last_mqtt_check) > mqtt_check_interval:
         try:
             client.ping()
-            last_mqtt_check = current_time
         except Exception as e:
             print(f"MQTT ping failed: {e} - attempting reconnect")
-            client = connect_mqtt()
-            last_mqtt_check = current_time
+            mark_link_lost("MQTT")
+        last_mqtt_check = current_time
+    
+    # Reconnect WiFi/MQTT in the background while node events are buffered
+    update_gateway_link()
     
     # Check MQTT messages
     safe_mqtt_check()
@@ -778,6 +1541,16 @@ while True:
     # Update LED blinking (non-blocking)
     update_led_blink()
     
+    # Stream the next bulk transfer window once the previous one is acknowledged
+    update_bulk_upload()
+    
+    # Poll I2C nodes instead of parsing the UART stream
+    if node_transport == "I2C":
+        if time.ticks_diff(current_time, last_i2c_poll) >= i2c_poll_interval:
+            poll_i2c_nodes()
+            last_i2c_poll = current_time
+        continue
+    
     # Process UART data from Arduino
     while uart.any():
         c = uart.read(1)
@@ -797,19 +1570,7 @@ while True:
                             data = parts[1].decode('utf-8').strip()
                             
                             print(f"Parsed: msg_code={msg_code}, data='{data}'")
-                            
-                            if msg_code == MSG_RFID_READ_SUCCESS:
-                                handle_rfid_detected(data)
-                            elif msg_code == MSG_RFID_READ_FAILED:
-                                print("RFID read failed")
-                                safe_mqtt_publish(topic_pub, "RFID_READ_FAILED")
-                            elif msg_code == MSG_STATUS_UPDATE:
-                                print(f"Arduino status update: {data}")
-                                safe_mqtt_publish(topic_pub, f"ARDUINO_STATUS:{data}")
-                            elif msg_code == MSG_HEARTBEAT:
-                                handle_arduino_heartbeat()
-                            else:
-                                print(f"Unknown message code with data: {msg_code}")
+                            process_arduino_data_message(msg_code, data)
                         else:
                             print(f"Invalid message format: {uart_buffer}")
                     except Exception as e:
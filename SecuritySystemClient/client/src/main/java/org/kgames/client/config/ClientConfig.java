@@ -24,6 +24,7 @@ public class ClientConfig {
     private static final String DEFAULT_TOPIC_SUB = "home/arduino/command";
     private static final String DEFAULT_TOPIC_AUTH_REQUEST = "home/arduino/auth_requests";
     private static final String DEFAULT_TOPIC_AUTH_RESPONSE = "home/arduino/auth_response";
+    private static final String DEFAULT_TOPIC_STATE = "home/arduino/state/#";
 
     private static final String CONFIG_DIR = "SecuritySystem";
     private static final String CONFIG_FILE = "security-system-config.properties";
@@ -81,6 +82,7 @@ public class ClientConfig {
         logger.info("  Subscribe Topic: " + getTopicSub());
         logger.info("  Auth Request Topic: " + getTopicAuthRequest());
         logger.info("  Auth Response Topic: " + getTopicAuthResponse());
+        logger.info("  Node State Topic: " + getTopicState());
     }
 
     /**
@@ -92,6 +94,7 @@ public class ClientConfig {
         properties.setProperty("mqtt.topic.sub", DEFAULT_TOPIC_SUB);
         properties.setProperty("mqtt.topic.auth.request", DEFAULT_TOPIC_AUTH_REQUEST);
         properties.setProperty("mqtt.topic.auth.response", DEFAULT_TOPIC_AUTH_RESPONSE);
+        properties.setProperty("mqtt.topic.state", DEFAULT_TOPIC_STATE);
 
         saveConfiguration();
     }
@@ -128,6 +131,10 @@ public class ClientConfig {
         return properties.getProperty("mqtt.topic.auth.response", DEFAULT_TOPIC_AUTH_RESPONSE);
     }
 
+    public String getTopicState() {
+        return properties.getProperty("mqtt.topic.state", DEFAULT_TOPIC_STATE);
+    }
+
     /**
      * Updates a configuration property and saves the file.
      * 
@@ -60,7 +60,7 @@ public class MainController implements Initializable, MqttService.MqttMessageLis
     private void initializeServices() {
         // Setup MQTT Listener connection
         mqttService.setMessageListener(this);
-        mqttService.connect(clientConfig.getMqttBroker(), clientConfig.getTopicSub());
+        mqttService.connect(clientConfig.getMqttBroker(), clientConfig.getTopicSub(), clientConfig.getTopicState());
     }
 
     /**
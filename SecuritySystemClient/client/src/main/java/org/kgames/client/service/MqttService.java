@@ -39,12 +39,12 @@ public class MqttService {
     }
 
     /**
-     * Connects to the MQTT broker and subscribes to a topic.
+     * Connects to the MQTT broker and subscribes to the given topics.
      * 
      * @param brokerUrl The MQTT broker URL
-     * @param topic     The topic to subscribe to
+     * @param topics    The topics (or topic filters) to subscribe to
      */
-    public void connect(String brokerUrl, String topic) {
+    public void connect(String brokerUrl, String... topics) {
         if (running)
             return;
 
@@ -87,7 +87,7 @@ public class MqttService {
                     });
 
                     client.connect(options);
-                    client.subscribe(topic);
+                    client.subscribe(topics);
 
                     if (messageListener != null) {
                         messageListener.onConnectionSuccess();
@@ -19,6 +19,17 @@ public class SensorStatusService implements MqttService.MqttMessageListener {
     private final List<SensorStatusListener> listeners = new ArrayList<>();
     private final Object listenersLock = new Object();
     
+    // Retained per-node state published by the Pico: home/arduino/state/<node>/<field>
+    private static final String NODE_STATE_TOPIC = "/state/";
+    // Retained gateway liveness under the same prefix: home/arduino/state/gateway, OFFLINE is the Pico's last will
+    private static final String GATEWAY_STATE_TOPIC = NODE_STATE_TOPIC + "gateway";
+    
+    // Last retained link/motion value per node - the shared ARDUINO and MOTION_SENSOR indicators aggregate all nodes
+    private final Map<String, String> nodeLinks = new TreeMap<>();
+    private final Map<String, String> nodeMotion = new TreeMap<>();
+    private final Object nodeStateLock = new Object();
+    private boolean gatewayOnline = true;
+    
     // Timeout settings (in seconds)
     private static final long ARDUINO_TIMEOUT = 60; // 60 seconds
     private static final long PICO_TIMEOUT = 60;    // 60 seconds
@@ -188,6 +199,11 @@ public class SensorStatusService implements MqttService.MqttMessageListener {
         // Update network status on any message received
         updateSensorStatus(SensorType.NETWORK, Status.ACTIVE, "MQTT active");
         
+        if (topic.contains(NODE_STATE_TOPIC)) {
+            handleNodeStateMessage(topic, message);
+            return;
+        }
+        
         try {
             switch (message) {
                 case "STATUS_READY":
@@ -236,6 +252,95 @@ public class SensorStatusService implements MqttService.MqttMessageListener {
         }
     }
     
+    /**
+     * Handles retained node state messages, which arrive for every node as soon as the client subscribes.
+     */
+    private void handleNodeStateMessage(String topic, String value) {
+        if (topic.endsWith(GATEWAY_STATE_TOPIC)) {
+            handleGatewayStateMessage(value);
+            return;
+        }
+        
+        String[] levels = topic.split("/");
+        if (levels.length < 2) {
+            return;
+        }
+        String node = levels[levels.length - 2];
+        String field = levels[levels.length - 1];
+        
+        synchronized (nodeStateLock) {
+            switch (field) {
+                case "motion":
+                    nodeMotion.put(node, value);
+                    break;
+                    
+                case "link":
+                    nodeLinks.put(node, value);
+                    break;
+                    
+                default:
+                    // Counters, LED and reader diagnostics are not shown as sensor statuses
+                    return;
+            }
+            if (gatewayOnline) {
+                updateNodeStatuses();
+            }
+        }
+    }
+    
+    /**
+     * Updates the shared ARDUINO and MOTION_SENSOR indicators from the state of all nodes, so one node
+     * cannot hide another: any offline node is an error, and motion on any node is reported.
+     * Callers hold nodeStateLock.
+     */
+    private void updateNodeStatuses() {
+        List<String> offline = new ArrayList<>();
+        for (Map.Entry<String, String> entry : nodeLinks.entrySet()) {
+            if (!"ONLINE".equals(entry.getValue())) {
+                offline.add(entry.getKey());
+            }
+        }
+        List<String> moving = new ArrayList<>();
+        for (Map.Entry<String, String> entry : nodeMotion.entrySet()) {
+            if ("ACTIVE".equals(entry.getValue())) {
+                moving.add(entry.getKey());
+            }
+        }
+        
+        if (!offline.isEmpty()) {
+            String nodeInfo = "Offline: " + String.join(", ", offline);
+            updateSensorStatus(SensorType.ARDUINO, Status.ERROR, "Communication Error!", nodeInfo);
+            updateSensorStatus(SensorType.MOTION_SENSOR, Status.ERROR, "Communication Error!", nodeInfo);
+            return;
+        }
+        if (!nodeLinks.isEmpty()) {
+            updateSensorStatus(SensorType.ARDUINO, Status.ACTIVE, "Connected", "Nodes: " + String.join(", ", nodeLinks.keySet()));
+        }
+        if (!moving.isEmpty()) {
+            updateSensorStatus(SensorType.MOTION_SENSOR, Status.INACTIVE, "Motion Detected!", "Nodes: " + String.join(", ", moving));
+        } else if (!nodeMotion.isEmpty()) {
+            updateSensorStatus(SensorType.MOTION_SENSOR, Status.ACTIVE, "No Motion Detected", "Nodes: " + String.join(", ", nodeMotion.keySet()));
+        }
+    }
+    
+    /**
+     * Handles the retained gateway liveness message. While the gateway is offline the retained
+     * node state is stale, so the nodes behind it are shown as unreachable.
+     */
+    private void handleGatewayStateMessage(String value) {
+        synchronized (nodeStateLock) {
+            gatewayOnline = "ONLINE".equals(value);
+            if (gatewayOnline) {
+                updateSensorStatus(SensorType.PICO, Status.ACTIVE, "Connected");
+                updateNodeStatuses();
+            } else {
+                updateSensorStatus(SensorType.PICO, Status.ERROR, "Gateway offline");
+                updateSensorStatus(SensorType.ARDUINO, Status.ERROR, "Communication Error!");
+                updateSensorStatus(SensorType.MOTION_SENSOR, Status.ERROR, "Communication Error!");
+            }
+        }
+    }
+    
     /**
      * Handles detailed Arduino status messages.
      */